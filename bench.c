@@ -0,0 +1,704 @@
+// bench.c - Banco de rendimiento: rendimiento, latencia y cambios de contexto
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include "memoria_compartida.h"
+
+#define SHM_BENCH      "/bench_canal"
+#define MAX_VALORES    16
+#define MAX_PROCESOS   128
+#define LLAVE_BENCH    "42"
+#define MAX_RUTA       (PATH_MAX + 64)   // Rutas derivadas de dir_bin con sufijo
+#define MATAR_CADA_S   0.1               // Pausa entre procesos matados con --matar
+#define DISPERSO_PASO  (256L << 20)      // Fuente dispersa: un bloque de texto cada 256 MiB
+#define DISPERSO_BLOQUE 65536
+
+// Matriz de configuraciones a recorrer
+typedef struct {
+    long tamanos[MAX_VALORES];
+    int n_tamanos;
+    long buffers[MAX_VALORES];
+    int n_buffers;
+    long emisores[MAX_VALORES];
+    int n_emisores;
+    long receptores[MAX_VALORES];
+    int n_receptores;
+    char *anillos[MAX_VALORES];
+    int n_anillos;
+    char *layouts[MAX_VALORES];
+    int n_layouts;
+    long carriles[MAX_VALORES];
+    int n_carriles;
+    long hilos[MAX_VALORES];  // Hilos de trabajo por proceso: E y R se reparten en procesos de H hilos
+    int n_hilos;
+    int lote;
+    const char *modo;         // Modo de emisor/receptor sin el sufijo de lote
+    char *segmento;           // Opciones del segmento para el inicializador, unidas con '+'
+    const char *salida;       // Archivo de resultados
+    int json;
+    int timeout_s;
+    int matar;                // Procesos a matar con SIGKILL durante cada corrida
+    int disperso;             // Fuente con huecos (sin ocupar disco) y verificación por suma
+} config_t;
+
+// Resultado de una corrida
+typedef struct {
+    double segundos;
+    double bytes_por_seg;
+    double lat_p50_us;
+    double lat_p99_us;
+    double lat_p999_us;
+    double res_p99_us;        // Residencia en el anillo
+    long cambios_contexto;
+    double cpu_s;
+    long long fallos_l1d;     // Fallos de lectura de L1D de todos los procesos, -1 sin contador
+    double apagado_ms;        // De la señal al finalizador hasta recoger a todos los procesos
+    int matados;
+    int recuperados;          // Procesos caídos que el finalizador recuperó
+    int ok;
+} resultado_t;
+
+static char dir_bin[PATH_MAX];
+static char dir_trabajo[PATH_MAX + 16];
+
+static double ahora_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// "64", "16K", "1M", "1G"
+static long parsear_tamano(const char *str) {
+    char *endptr;
+    long valor = strtol(str, &endptr, 10);
+    switch (*endptr) {
+    case 'K': case 'k': valor <<= 10; endptr++; break;
+    case 'M': case 'm': valor <<= 20; endptr++; break;
+    case 'G': case 'g': valor <<= 30; endptr++; break;
+    default: break;
+    }
+    return (*endptr == '\0' && valor > 0) ? valor : -1;
+}
+
+static int parsear_lista_num(const char *str, long *valores, int *n) {
+    char copia[256];
+    strncpy(copia, str, sizeof(copia) - 1);
+    copia[sizeof(copia) - 1] = '\0';
+
+    *n = 0;
+    for (char *tok = strtok(copia, ","); tok && *n < MAX_VALORES; tok = strtok(NULL, ",")) {
+        long v = parsear_tamano(tok);
+        if (v < 0) {
+            return -1;
+        }
+        valores[(*n)++] = v;
+    }
+    return *n > 0 ? 0 : -1;
+}
+
+static void parsear_lista_str(char *str, char **valores, int *n) {
+    *n = 0;
+    for (char *tok = strtok(str, ","); tok && *n < MAX_VALORES; tok = strtok(NULL, ",")) {
+        valores[(*n)++] = tok;
+    }
+}
+
+static void uso(const char *prog) {
+    fprintf(stderr, "Uso: %s [opciones]\n", prog);
+    fprintf(stderr, "  --tamanos=1M,16M        Tamaños de la fuente generada (K/M/G)\n");
+    fprintf(stderr, "  --buffers=64,4096       Tamaños del buffer compartido\n");
+    fprintf(stderr, "  --emisores=1,2          Cantidad de emisores\n");
+    fprintf(stderr, "  --receptores=1,2        Cantidad de receptores\n");
+    fprintf(stderr, "  --anillo=mutex,lockfree Modos de anillo (difusion, registros: con --carriles=1)\n");
+    fprintf(stderr, "  --layout=aos,soa        Layouts de slots\n");
+    fprintf(stderr, "  --carriles=1,4          Carriles del anillo\n");
+    fprintf(stderr, "  --hilos=1,4             Hilos por proceso (4 emisores con 4 hilos = 1 proceso)\n");
+    fprintf(stderr, "  --lote=256              Lote de emisores y receptores\n");
+    fprintf(stderr, "  --modo=max              Modo de ejecución: max, adaptive[:<obj>%%], rate:<b/s> (sin ':batch')\n");
+    fprintf(stderr, "  --segmento=huge+populate Opciones del segmento (huge, thp, populate, mlock, numa=<n>)\n");
+    fprintf(stderr, "  --formato=csv|json      Formato de resultados\n");
+    fprintf(stderr, "  --salida=out/bench.csv  Archivo de resultados\n");
+    fprintf(stderr, "  --timeout=600           Segundos máximos por corrida\n");
+    fprintf(stderr, "  --matar=0               Emisores/receptores a matar con SIGKILL durante la corrida\n");
+    fprintf(stderr, "  --disperso=0            1: fuente dispersa de varios GB, verificada con una suma\n");
+}
+
+static int parsear_config(int argc, char *argv[], config_t *cfg) {
+    static char anillos_def[] = "mutex,lockfree";
+    static char layouts_def[] = "aos";
+
+    memset(cfg, 0, sizeof(*cfg));
+    parsear_lista_num("1M", cfg->tamanos, &cfg->n_tamanos);
+    parsear_lista_num("4096", cfg->buffers, &cfg->n_buffers);
+    parsear_lista_num("1,2", cfg->emisores, &cfg->n_emisores);
+    parsear_lista_num("1,2", cfg->receptores, &cfg->n_receptores);
+    parsear_lista_str(anillos_def, cfg->anillos, &cfg->n_anillos);
+    parsear_lista_str(layouts_def, cfg->layouts, &cfg->n_layouts);
+    parsear_lista_num("1", cfg->carriles, &cfg->n_carriles);
+    parsear_lista_num("1", cfg->hilos, &cfg->n_hilos);
+    cfg->lote = 256;
+    cfg->modo = "max";
+    cfg->salida = NULL;
+    cfg->timeout_s = 600;
+
+    for (int i = 1; i < argc; i++) {
+        char *arg = argv[i];
+        char *valor = strchr(arg, '=');
+        if (strncmp(arg, "--", 2) != 0 || !valor) {
+            return -1;
+        }
+        *valor++ = '\0';
+
+        int error = 0;
+        if (strcmp(arg, "--tamanos") == 0) {
+            error = parsear_lista_num(valor, cfg->tamanos, &cfg->n_tamanos);
+        } else if (strcmp(arg, "--buffers") == 0) {
+            error = parsear_lista_num(valor, cfg->buffers, &cfg->n_buffers);
+        } else if (strcmp(arg, "--emisores") == 0) {
+            error = parsear_lista_num(valor, cfg->emisores, &cfg->n_emisores);
+        } else if (strcmp(arg, "--receptores") == 0) {
+            error = parsear_lista_num(valor, cfg->receptores, &cfg->n_receptores);
+        } else if (strcmp(arg, "--anillo") == 0) {
+            parsear_lista_str(valor, cfg->anillos, &cfg->n_anillos);
+        } else if (strcmp(arg, "--layout") == 0) {
+            parsear_lista_str(valor, cfg->layouts, &cfg->n_layouts);
+        } else if (strcmp(arg, "--carriles") == 0) {
+            error = parsear_lista_num(valor, cfg->carriles, &cfg->n_carriles);
+        } else if (strcmp(arg, "--hilos") == 0) {
+            error = parsear_lista_num(valor, cfg->hilos, &cfg->n_hilos);
+        } else if (strcmp(arg, "--lote") == 0) {
+            cfg->lote = atoi(valor);
+            error = cfg->lote > 0 ? 0 : -1;
+        } else if (strcmp(arg, "--modo") == 0) {
+            cfg->modo = valor;
+        } else if (strcmp(arg, "--segmento") == 0) {
+            cfg->segmento = valor;
+        } else if (strcmp(arg, "--formato") == 0) {
+            cfg->json = strcmp(valor, "json") == 0;
+            error = (cfg->json || strcmp(valor, "csv") == 0) ? 0 : -1;
+        } else if (strcmp(arg, "--salida") == 0) {
+            cfg->salida = valor;
+        } else if (strcmp(arg, "--timeout") == 0) {
+            cfg->timeout_s = atoi(valor);
+            error = cfg->timeout_s > 0 ? 0 : -1;
+        } else if (strcmp(arg, "--matar") == 0) {
+            cfg->matar = atoi(valor);
+            error = cfg->matar >= 0 ? 0 : -1;
+        } else if (strcmp(arg, "--disperso") == 0) {
+            cfg->disperso = atoi(valor);
+        } else {
+            error = -1;
+        }
+        if (error) {
+            return -1;
+        }
+    }
+
+    if (!cfg->salida) {
+        cfg->salida = cfg->json ? "out/bench.json" : "out/bench.csv";
+    }
+    return 0;
+}
+
+/*
+ * Fuente dispersa: un archivo del tamaño pedido hecho de huecos, con un
+ * bloque de texto cada DISPERSO_PASO y otro al final, de modo que haya
+ * datos a ambos lados de los 2 y 4 GiB sin ocupar disco ni tiempo.
+ */
+static int generar_disperso(long tamano, const char *ruta) {
+    int fd = open(ruta, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1 || ftruncate(fd, tamano) == -1) {
+        perror("Error al crear la fuente dispersa");
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    char bloque[DISPERSO_BLOQUE];
+    for (long inicio = 0; inicio < tamano; inicio += DISPERSO_PASO) {
+        for (int pasada = 0; pasada < 2; pasada++) {
+            // Un bloque al comienzo de cada paso y otro que termina justo antes del siguiente
+            long fin = inicio + DISPERSO_PASO < tamano ? inicio + DISPERSO_PASO : tamano;
+            long desde = pasada == 0 ? inicio : fin - DISPERSO_BLOQUE;
+            if (desde < inicio) {
+                desde = inicio;
+            }
+            long n = fin - desde < DISPERSO_BLOQUE ? fin - desde : DISPERSO_BLOQUE;
+            int escritos = snprintf(bloque, sizeof(bloque), "offset %ld\n", desde);
+            for (long i = escritos; i < n; i++) {
+                bloque[i] = 'a' + (char)((desde + i) % 26);
+            }
+            if (pwrite(fd, bloque, n, desde) != n) {
+                perror("Error al escribir la fuente dispersa");
+                close(fd);
+                return -1;
+            }
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+// Generar (o reutilizar) una fuente de texto pseudoaleatorio del tamaño pedido
+static int generar_fuente(long tamano, int disperso, char *ruta, size_t len) {
+    snprintf(ruta, len, "%s/fuente_%s%ld.txt", dir_trabajo, disperso ? "disperso_" : "", tamano);
+
+    struct stat st;
+    if (stat(ruta, &st) == 0 && st.st_size == tamano) {
+        return 0;
+    }
+    if (disperso) {
+        return generar_disperso(tamano, ruta);
+    }
+
+    FILE *f = fopen(ruta, "w");
+    if (!f) {
+        perror("Error al crear la fuente");
+        return -1;
+    }
+
+    static const char alfabeto[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ.,;\n";
+    char bloque[65536];
+    unsigned int semilla = 12345;
+    long restantes = tamano;
+    while (restantes > 0) {
+        long n = restantes < (long)sizeof(bloque) ? restantes : (long)sizeof(bloque);
+        for (long i = 0; i < n; i++) {
+            semilla = semilla * 1103515245u + 12345u;
+            bloque[i] = alfabeto[(semilla >> 16) % (sizeof(alfabeto) - 1)];
+        }
+        fwrite(bloque, 1, n, f);
+        restantes -= n;
+    }
+    fclose(f);
+    return 0;
+}
+
+// Lanzar un binario del proyecto en el directorio de trabajo, sin consola
+static pid_t lanzar(char *const argv[]) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (chdir(dir_trabajo) == -1) {
+            _exit(127);
+        }
+        int devnull = open("/dev/null", O_RDWR);
+        dup2(devnull, STDIN_FILENO);
+        dup2(devnull, STDOUT_FILENO);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+/*
+ * Contador de fallos de lectura en L1D heredado por los procesos hijos: las
+ * líneas que otro núcleo invalidó (falso compartir) aparecen como fallos.
+ * Devuelve -1 si el núcleo o la máquina virtual no exponen el contador.
+ */
+static int abrir_contador_l1d(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void acumular_uso(const struct rusage *ru, resultado_t *res) {
+    res->cambios_contexto += ru->ru_nvcsw + ru->ru_nivcsw;
+    res->cpu_s += ru->ru_utime.tv_sec + ru->ru_utime.tv_usec / 1e6 +
+                  ru->ru_stime.tv_sec + ru->ru_stime.tv_usec / 1e6;
+}
+
+static int archivos_iguales(const char *a, const char *b) {
+    FILE *fa = fopen(a, "r"), *fb = fopen(b, "r");
+    int iguales = fa && fb;
+    char ba[65536], bb[65536];
+
+    while (iguales) {
+        size_t na = fread(ba, 1, sizeof(ba), fa);
+        size_t nb = fread(bb, 1, sizeof(bb), fb);
+        if (na != nb || memcmp(ba, bb, na) != 0) {
+            iguales = 0;
+        }
+        if (na == 0) {
+            break;
+        }
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return iguales;
+}
+
+// Suma FNV-1a de 64 bits de un archivo completo; 0 si no se pudo leer
+static uint64_t suma_archivo(const char *ruta) {
+    FILE *f = fopen(ruta, "r");
+    if (!f) {
+        return 0;
+    }
+    uint64_t suma = 1469598103934665603ull;
+    char bloque[65536];
+    size_t n;
+    while ((n = fread(bloque, 1, sizeof(bloque), f)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            suma = (suma ^ (unsigned char)bloque[i]) * 1099511628211ull;
+        }
+    }
+    fclose(f);
+    return suma;
+}
+
+/*
+ * Matar con SIGKILL a un emisor o receptor al azar, sin dejar a ningún tipo
+ * sin procesos vivos, y recogerlo. Devuelve 1 si mató a un emisor, 2 si
+ * mató a un receptor y 0 si no quedaba a quién.
+ */
+static int matar_uno(pid_t *emisores, int n_emisores, pid_t *receptores, int n_receptores,
+                     unsigned int *semilla, resultado_t *res) {
+    pid_t *candidatos[2 * MAX_PROCESOS];
+    int n = 0, vivos_e = 0, vivos_r = 0;
+    for (int i = 0; i < n_emisores; i++) {
+        vivos_e += emisores[i] > 0;
+    }
+    for (int i = 0; i < n_receptores; i++) {
+        vivos_r += receptores[i] > 0;
+    }
+    for (int i = 0; vivos_e > 1 && i < n_emisores; i++) {
+        if (emisores[i] > 0) {
+            candidatos[n++] = &emisores[i];
+        }
+    }
+    for (int i = 0; vivos_r > 1 && i < n_receptores; i++) {
+        if (receptores[i] > 0) {
+            candidatos[n++] = &receptores[i];
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    pid_t *victima = candidatos[rand_r(semilla) % n];
+    int tipo = (victima >= emisores && victima < emisores + n_emisores) ? 1 : 2;
+    struct rusage ru;
+    int estado;
+    kill(*victima, SIGKILL);
+    if (wait4(*victima, &estado, 0, &ru) > 0) {
+        acumular_uso(&ru, res);
+    }
+    *victima = 0;
+    res->matados++;
+    return tipo;
+}
+
+// Hilos del proceso i cuando n trabajadores se agrupan en procesos de hasta h hilos
+static int hilos_de(int n, long h, int i) {
+    return (int)(n - i * h < h ? n - i * h : h);
+}
+
+static int correr(const config_t *cfg, long tamano, long buffer, int trabajadores_e,
+                  int trabajadores_r, const char *anillo, const char *layout, long carriles,
+                  long hilos, resultado_t *res) {
+    char fuente[MAX_RUTA], salida[MAX_RUTA];
+    char bin_ini[MAX_RUTA], bin_emi[MAX_RUTA], bin_rec[MAX_RUTA], bin_fin[MAX_RUTA];
+    char buffer_str[32], carriles_str[32], modo[128], hilos_str[32];
+
+    memset(res, 0, sizeof(*res));
+    if (trabajadores_e > MAX_PROCESOS || trabajadores_r > MAX_PROCESOS) {
+        fprintf(stderr, "Error: máximo %d emisores/receptores por corrida\n", MAX_PROCESOS);
+        return -1;
+    }
+    // Los emisores y receptores corren en procesos de hasta `hilos` hilos de trabajo
+    int n_emisores = (int)((trabajadores_e + hilos - 1) / hilos);
+    int n_receptores = (int)((trabajadores_r + hilos - 1) / hilos);
+    if (generar_fuente(tamano, cfg->disperso, fuente, sizeof(fuente)) < 0) {
+        return -1;
+    }
+    snprintf(salida, sizeof(salida), "%s/%s", dir_trabajo, ARCHIVO_SALIDA);
+    snprintf(bin_ini, sizeof(bin_ini), "%s/inicializador", dir_bin);
+    snprintf(bin_emi, sizeof(bin_emi), "%s/emisor", dir_bin);
+    snprintf(bin_rec, sizeof(bin_rec), "%s/receptor", dir_bin);
+    snprintf(bin_fin, sizeof(bin_fin), "%s/finalizador", dir_bin);
+    snprintf(buffer_str, sizeof(buffer_str), "%ld", buffer);
+    snprintf(carriles_str, sizeof(carriles_str), "carriles=%ld", carriles);
+    snprintf(modo, sizeof(modo), "%s:batch=%d", cfg->modo, cfg->lote);
+
+    // 1. Inicializador
+    char *argv_ini[8 + MAX_VALORES] = { bin_ini, SHM_BENCH, buffer_str, fuente, (char *)anillo,
+                                        (char *)layout, carriles_str };
+    char segmento[256] = "";
+    if (cfg->segmento) {
+        strncpy(segmento, cfg->segmento, sizeof(segmento) - 1);
+    }
+    int n_ini = 7;
+    for (char *tok = strtok(segmento, "+"); tok && n_ini < 7 + MAX_VALORES; tok = strtok(NULL, "+")) {
+        argv_ini[n_ini++] = tok;
+    }
+    argv_ini[n_ini] = NULL;
+    int estado;
+    waitpid(lanzar(argv_ini), &estado, 0);
+    if (!WIFEXITED(estado) || WEXITSTATUS(estado) != 0) {
+        fprintf(stderr, "Error: el inicializador falló\n");
+        return -1;
+    }
+
+    size_t shm_size;
+    shared_mem_t *shm = adjuntar_segmento(SHM_BENCH, PROT_READ, NULL, &shm_size);
+    if (!shm) {
+        return -1;
+    }
+
+    // 2. Receptores y emisores (heredan el contador de caché ya habilitado)
+    int contador = abrir_contador_l1d();
+    if (contador != -1) {
+        ioctl(contador, PERF_EVENT_IOC_RESET, 0);
+        ioctl(contador, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    pid_t emisores[MAX_PROCESOS], receptores[MAX_PROCESOS];
+    char *argv_rec[] = { bin_rec, SHM_BENCH, LLAVE_BENCH, modo, hilos_str, NULL };
+    char *argv_emi[] = { bin_emi, SHM_BENCH, LLAVE_BENCH, modo, hilos_str, NULL };
+
+    // El finalizador corre desde el principio: supervisa y recupera a los caídos
+    char *argv_fin[] = { bin_fin, SHM_BENCH, NULL };
+    pid_t finalizador = lanzar(argv_fin);
+
+    double t0 = ahora_s();
+    for (int i = 0; i < n_receptores; i++) {
+        snprintf(hilos_str, sizeof(hilos_str), "--threads=%d", hilos_de(trabajadores_r, hilos, i));
+        receptores[i] = lanzar(argv_rec);
+    }
+    for (int i = 0; i < n_emisores; i++) {
+        snprintf(hilos_str, sizeof(hilos_str), "--threads=%d", hilos_de(trabajadores_e, hilos, i));
+        emisores[i] = lanzar(argv_emi);
+    }
+
+    // 3. Esperar a que todo el archivo pase por el anillo (matando procesos si se pidió)
+    int emisores_vivos = n_emisores;
+    int completo = 0;
+    unsigned int semilla = (unsigned int)tamano;
+    double proxima_muerte = t0 + MATAR_CADA_S;
+
+    while (1) {
+        for (int i = 0; i < n_emisores; i++) {
+            struct rusage ru;
+            if (emisores[i] > 0 && wait4(emisores[i], &estado, WNOHANG, &ru) == emisores[i]) {
+                acumular_uso(&ru, res);
+                emisores[i] = 0;
+                emisores_vivos--;
+            }
+        }
+
+        if (res->matados < cfg->matar && ahora_s() >= proxima_muerte) {
+            if (matar_uno(emisores, n_emisores, receptores, n_receptores, &semilla, res) == 1) {
+                emisores_vivos--;
+            }
+            proxima_muerte += MATAR_CADA_S;
+        }
+
+        int64_t transferidos = (int64_t)total_procesos(shm, PROCESO_EMISOR);
+
+        if (transferidos >= tamano && chars_en_anillo(shm) <= 0) {
+            completo = 1;
+            break;
+        }
+        // Con caídas se pierden los tramos en curso: basta con que el anillo se vacíe
+        if (emisores_vivos == 0 && cfg->matar > 0) {
+            if (chars_en_anillo(shm) <= 0) {
+                completo = 1;
+                break;
+            }
+        } else if (emisores_vivos == 0 && transferidos < tamano) {
+            fprintf(stderr, "Error: los emisores terminaron antes de enviar todo\n");
+            break;
+        }
+        if (ahora_s() - t0 > cfg->timeout_s) {
+            fprintf(stderr, "Error: tiempo agotado\n");
+            break;
+        }
+
+        struct timespec pausa = { 0, 1000000L };
+        nanosleep(&pausa, NULL);
+    }
+    double t1 = ahora_s();
+
+    // 4. Finalizador: señalarlo (cuando ya bloqueó sus señales) y recoger a todos los procesos
+    double pendiente = 0.1 - (ahora_s() - t0);
+    if (pendiente > 0) {
+        usleep((useconds_t)(pendiente * 1e6));
+    }
+    double t_apagado = ahora_s();
+    kill(finalizador, SIGINT);
+
+    for (int i = 0; i < n_emisores; i++) {
+        struct rusage ru;
+        if (emisores[i] > 0 && wait4(emisores[i], &estado, 0, &ru) > 0) {
+            acumular_uso(&ru, res);
+        }
+    }
+    for (int i = 0; i < n_receptores; i++) {
+        struct rusage ru;
+        if (receptores[i] > 0 && wait4(receptores[i], &estado, 0, &ru) > 0) {
+            acumular_uso(&ru, res);
+        }
+    }
+    waitpid(finalizador, &estado, 0);
+    res->apagado_ms = (ahora_s() - t_apagado) * 1e3;
+    res->recuperados = shm->procesos_caidos;
+
+    // Con todos los hijos recogidos el contador ya incluye sus fallos
+    res->fallos_l1d = -1;
+    if (contador != -1) {
+        long long fallos;
+        ioctl(contador, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(contador, &fallos, sizeof(fallos)) == sizeof(fallos)) {
+            res->fallos_l1d = fallos;
+        }
+        close(contador);
+    }
+
+    // Latencias por byte registradas por los receptores en la memoria compartida
+    histograma_t extremo, residencia;
+    hist_sumar(&extremo, shm->extremo, MAX_HISTOGRAMAS);
+    hist_sumar(&residencia, shm->residencia, MAX_HISTOGRAMAS);
+    res->lat_p50_us = hist_percentil(&extremo, 0.50) / 1000.0;
+    res->lat_p99_us = hist_percentil(&extremo, 0.99) / 1000.0;
+    res->lat_p999_us = hist_percentil(&extremo, 0.999) / 1000.0;
+    res->res_p99_us = hist_percentil(&residencia, 0.99) / 1000.0;
+
+    munmap(shm, shm_size);
+    eliminar_segmento(SHM_BENCH);
+
+    res->segundos = t1 - t0;
+    res->bytes_por_seg = tamano / res->segundos;
+
+    // Con caídas la salida tiene huecos: alcanza con que el anillo no se haya trabado
+    if (completo && cfg->matar == 0 && cfg->disperso) {
+        uint64_t suma_fuente = suma_archivo(fuente);
+        uint64_t suma_salida = suma_archivo(salida);
+        printf("Suma FNV-1a: fuente %016llx, salida %016llx\n",
+               (unsigned long long)suma_fuente, (unsigned long long)suma_salida);
+        res->ok = suma_fuente != 0 && suma_fuente == suma_salida;
+    } else {
+        res->ok = completo && (cfg->matar > 0 || archivos_iguales(fuente, salida));
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    config_t cfg;
+    if (parsear_config(argc, argv, &cfg) < 0) {
+        uso(argv[0]);
+        return 1;
+    }
+
+    // Los binarios viven junto a este ejecutable; las corridas usan out/bench_tmp
+    if (!realpath(argv[0], dir_bin)) {
+        perror("Error al resolver la ruta del banco");
+        return 1;
+    }
+    *strrchr(dir_bin, '/') = '\0';
+    snprintf(dir_trabajo, sizeof(dir_trabajo), "%s/bench_tmp", dir_bin);
+    mkdir(dir_trabajo, 0755);
+
+    FILE *out = fopen(cfg.salida, "w");
+    if (!out) {
+        perror("Error al abrir el archivo de resultados");
+        return 1;
+    }
+
+    printf(COLOR_BOLD COLOR_CYAN "=== Banco de rendimiento ===\n" COLOR_RESET);
+    printf("%-10s %-7s %-4s %-4s %-9s %-4s %-3s %-3s %12s %10s %10s %10s %8s %12s %10s %7s %s\n",
+           "tamaño", "buffer", "E", "R", "anillo", "lay", "K", "H", "bytes/s",
+           "p50(us)", "p99(us)", "p99.9(us)", "csw", "fallos L1D", "apagado ms", "caídos", "ok");
+
+    if (cfg.json) {
+        fprintf(out, "[\n");
+    } else {
+        fprintf(out, "tamano,buffer,emisores,receptores,anillo,layout,carriles,hilos,lote,modo,segundos,"
+                     "bytes_por_seg,lat_p50_us,lat_p99_us,lat_p999_us,res_p99_us,cambios_contexto,cpu_s,"
+                     "fallos_l1d,apagado_ms,matados,recuperados,ok\n");
+    }
+
+    int primero = 1, fallos = 0;
+    for (int a = 0; a < cfg.n_tamanos; a++)
+    for (int b = 0; b < cfg.n_buffers; b++)
+    for (int e = 0; e < cfg.n_emisores; e++)
+    for (int r = 0; r < cfg.n_receptores; r++)
+    for (int m = 0; m < cfg.n_anillos; m++)
+    for (int l = 0; l < cfg.n_layouts; l++)
+    for (int k = 0; k < cfg.n_carriles; k++)
+    for (int h = 0; h < cfg.n_hilos; h++) {
+        resultado_t res;
+        if (correr(&cfg, cfg.tamanos[a], cfg.buffers[b], (int)cfg.emisores[e], (int)cfg.receptores[r],
+                   cfg.anillos[m], cfg.layouts[l], cfg.carriles[k], cfg.hilos[h], &res) < 0) {
+            fallos++;
+            continue;
+        }
+        fallos += !res.ok;
+
+        char fallos[32] = "n/d";
+        if (res.fallos_l1d >= 0) {
+            snprintf(fallos, sizeof(fallos), "%lld", res.fallos_l1d);
+        }
+        char caidos[32];
+        snprintf(caidos, sizeof(caidos), "%d/%d", res.recuperados, res.matados);
+        printf("%-10ld %-7ld %-4ld %-4ld %-9s %-4s %-3ld %-3ld %12.0f %10.1f %10.1f %10.1f %8ld %12s %10.1f %7s %s\n",
+               cfg.tamanos[a], cfg.buffers[b], cfg.emisores[e], cfg.receptores[r],
+               cfg.anillos[m], cfg.layouts[l], cfg.carriles[k], cfg.hilos[h], res.bytes_por_seg,
+               res.lat_p50_us, res.lat_p99_us, res.lat_p999_us, res.cambios_contexto, fallos,
+               res.apagado_ms, caidos, res.ok ? COLOR_GREEN "sí" COLOR_RESET : COLOR_RED "NO" COLOR_RESET);
+        fflush(stdout);
+
+        if (cfg.json) {
+            fprintf(out, "%s  {\"tamano\": %ld, \"buffer\": %ld, \"emisores\": %ld, \"receptores\": %ld, "
+                         "\"anillo\": \"%s\", \"layout\": \"%s\", \"carriles\": %ld, \"hilos\": %ld, \"lote\": %d, \"modo\": \"%s\", "
+                         "\"segundos\": %.6f, \"bytes_por_seg\": %.0f, \"lat_p50_us\": %.3f, "
+                         "\"lat_p99_us\": %.3f, \"lat_p999_us\": %.3f, \"res_p99_us\": %.3f, "
+                         "\"cambios_contexto\": %ld, "
+                         "\"cpu_s\": %.3f, \"fallos_l1d\": %lld, \"apagado_ms\": %.3f, \"matados\": %d, "
+                         "\"recuperados\": %d, \"ok\": %s}",
+                    primero ? "" : ",\n", cfg.tamanos[a], cfg.buffers[b], cfg.emisores[e],
+                    cfg.receptores[r], cfg.anillos[m], cfg.layouts[l], cfg.carriles[k],
+                    cfg.hilos[h], cfg.lote, cfg.modo,
+                    res.segundos, res.bytes_por_seg, res.lat_p50_us, res.lat_p99_us,
+                    res.lat_p999_us, res.res_p99_us, res.cambios_contexto, res.cpu_s,
+                    res.fallos_l1d, res.apagado_ms, res.matados, res.recuperados,
+                    res.ok ? "true" : "false");
+        } else {
+            fprintf(out, "%ld,%ld,%ld,%ld,%s,%s,%ld,%ld,%d,%s,%.6f,%.0f,%.3f,%.3f,%.3f,%.3f,%ld,%.3f,%lld,%.3f,%d,%d,%d\n",
+                    cfg.tamanos[a], cfg.buffers[b], cfg.emisores[e], cfg.receptores[r],
+                    cfg.anillos[m], cfg.layouts[l], cfg.carriles[k], cfg.hilos[h], cfg.lote, cfg.modo,
+                    res.segundos,
+                    res.bytes_por_seg, res.lat_p50_us, res.lat_p99_us, res.lat_p999_us,
+                    res.res_p99_us, res.cambios_contexto, res.cpu_s, res.fallos_l1d, res.apagado_ms,
+                    res.matados, res.recuperados, res.ok);
+        }
+        primero = 0;
+    }
+
+    if (cfg.json) {
+        fprintf(out, "\n]\n");
+    }
+    fclose(out);
+
+    printf("\nResultados en: %s\n", cfg.salida);
+    return fallos ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+// bench_cifrado.c - GB/s por núcleo de cada variante del núcleo de cifrado
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cifrado.h"
+#include "memoria_compartida.h"
+
+#define SEGUNDOS_POR_MEDIDA 0.25
+
+static const size_t tamanos[] = { 4096, 256 * 1024, 16 * 1024 * 1024 };
+static const char *llaves[] = { "42", "0x2A7F10C3B5E9D1", "0x00112233445566778899AABBCCDDEEFF0123" };
+
+static double ahora_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Repetir el cifrado en el lugar hasta cubrir el tiempo de medida
+static double medir(cifrar_fn fn, unsigned char *datos, size_t n, const llave_t *llave) {
+    long vueltas = 0;
+    double t0 = ahora_s(), t;
+    do {
+        for (int i = 0; i < 16; i++) {
+            fn(datos, datos, n, llave, vueltas + i);
+        }
+        vueltas += 16;
+        t = ahora_s();
+    } while (t - t0 < SEGUNDOS_POR_MEDIDA);
+    return (double)n * vueltas / (t - t0) / 1e9;
+}
+
+int main(void) {
+    const variante_cifrado_t *variantes;
+    int n_variantes = cifrado_variantes(&variantes);
+
+    size_t max = tamanos[sizeof(tamanos) / sizeof(tamanos[0]) - 1];
+    unsigned char *origen = malloc(max + 1);
+    unsigned char *referencia = malloc(max + 1);
+    unsigned char *datos = malloc(max + 1);
+    if (!origen || !referencia || !datos) {
+        perror("Error al reservar memoria");
+        return 1;
+    }
+    for (size_t i = 0; i <= max; i++) {
+        origen[i] = (unsigned char)(i * 131 + 7);
+    }
+
+    printf(COLOR_BOLD COLOR_CYAN "=== Banco del núcleo de cifrado (un núcleo) ===\n" COLOR_RESET);
+    printf("%-10s %-6s %-10s %10s %s\n", "variante", "llave", "tamaño", "GB/s", "ok");
+
+    int fallos = 0;
+    for (size_t l = 0; l < sizeof(llaves) / sizeof(llaves[0]); l++) {
+        llave_t llave;
+        llave_parsear(llaves[l], &llave);
+
+        for (size_t t = 0; t < sizeof(tamanos) / sizeof(tamanos[0]); t++) {
+            size_t n = tamanos[t];
+
+            // Referencia: la variante escalar desde un origen desalineado y offset impar
+            variantes[0].fn(referencia, origen + 1, n, &llave, 12345);
+
+            for (int v = 0; v < n_variantes; v++) {
+                memset(datos, 0, n);
+                variantes[v].fn(datos, origen + 1, n, &llave, 12345);
+                int ok = memcmp(datos, referencia, n) == 0;
+                for (size_t i = 0; ok && i < 64 && i < n; i++) {
+                    ok = datos[i] == (origen[1 + i] ^ llave.bytes[(12345 + i) % llave.len]);
+                }
+                fallos += !ok;
+
+                double gbs = medir(variantes[v].fn, datos, n, &llave);
+                printf("%-10s %-6d %-10zu %10.2f %s\n", variantes[v].nombre, llave.len, n, gbs,
+                       ok ? COLOR_GREEN "sí" COLOR_RESET : COLOR_RED "NO" COLOR_RESET);
+            }
+        }
+    }
+
+    free(origen);
+    free(referencia);
+    free(datos);
+    return fallos ? 1 : 0;
+}
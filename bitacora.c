@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitacora.h"
+#include "memoria_compartida.h"
+
+int bitacora_parsear(const char *str, int *nivel, long *resumen_ms) {
+    *resumen_ms = RESUMEN_MS_DEFECTO;
+
+    if (strcmp(str, "bytes") == 0) {
+        *nivel = BITACORA_BYTES;
+        return 0;
+    }
+    if (strcmp(str, "silencio") == 0) {
+        *nivel = BITACORA_SILENCIO;
+        return 0;
+    }
+    if (strncmp(str, "resumen", 7) == 0) {
+        *nivel = BITACORA_RESUMEN;
+        if (str[7] == '\0') {
+            return 0;
+        }
+        if (str[7] == '/') {
+            char *endptr;
+            *resumen_ms = strtol(str + 8, &endptr, 10);
+            if (endptr != str + 8 && *endptr == '\0' && *resumen_ms > 0) {
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+void bitacora_describir(int nivel, long resumen_ms, char *buf, size_t len) {
+    switch (nivel) {
+    case BITACORA_SILENCIO:
+        snprintf(buf, len, "silencio");
+        break;
+    case BITACORA_RESUMEN:
+        snprintf(buf, len, "resumen cada %ld ms", resumen_ms);
+        break;
+    default:
+        snprintf(buf, len, "un carácter por línea");
+        break;
+    }
+}
+
+// Escribir el texto acumulado de una vez, después de lo que haya impreso el proceso
+static void volcar(bitacora_t *b) {
+    if (b->usado > 0) {
+        fwrite(b->texto, 1, b->usado, stdout);
+        fflush(stdout);
+        b->usado = 0;
+    }
+}
+
+static char *reservar(bitacora_t *b, size_t n) {
+    if (b->usado + n > TEXTO_BITACORA) {
+        volcar(b);
+    }
+    return b->texto + b->usado;
+}
+
+#define AGREGAR(b, ...) \
+    ((b)->usado += (size_t)snprintf(reservar((b), 128), 128, __VA_ARGS__))
+
+static void formatear(bitacora_t *b, const entrada_bitacora_t *e) {
+    // La hora solo se vuelve a formatear cuando cambia el segundo
+    if (b->tipo == BITACORA_EMISOR && e->hora != b->ultimo_segundo) {
+        strftime(b->hora_str, sizeof(b->hora_str), "%H:%M:%S", localtime(&e->hora));
+        b->ultimo_segundo = e->hora;
+    }
+
+    for (int i = 0; i < e->n; i++) {
+        unsigned char c = e->valores[i];
+        char display_char = (c >= 32 && c < 127) ? c : '.';
+        if (b->tipo == BITACORA_EMISOR) {
+            AGREGAR(b, COLOR_GREEN "'%c'" COLOR_RESET "        %-8d %-10lld %s\n",
+                    display_char, c, (long long)e->posiciones[i], b->hora_str);
+        } else {
+            AGREGAR(b, COLOR_BLUE "'%c'" COLOR_RESET "        %-8d %-10lld %.1f\n",
+                    display_char, c, (long long)e->posiciones[i], e->latencias_ns[i] / 1000.0);
+        }
+    }
+}
+
+static void resumir(bitacora_t *b, uint64_t ahora) {
+    uint64_t bytes = __atomic_load_n(&b->bytes, __ATOMIC_RELAXED);
+    uint64_t lotes = __atomic_load_n(&b->lotes, __ATOMIC_RELAXED);
+    double segundos = (ahora - b->resumen_ns) / 1e9;
+
+    time_t hora = time(NULL);
+    char hora_str[20];
+    strftime(hora_str, sizeof(hora_str), "%H:%M:%S", localtime(&hora));
+
+    AGREGAR(b, COLOR_CYAN "[%s]" COLOR_RESET " %llu caracteres %s en %llu lotes (%.0f bytes/s)\n",
+            hora_str, (unsigned long long)bytes,
+            b->tipo == BITACORA_EMISOR ? "escritos" : "leídos", (unsigned long long)lotes,
+            segundos > 0 ? (bytes - b->resumen_bytes) / segundos : 0.0);
+
+    b->resumen_bytes = bytes;
+    b->resumen_ns = ahora;
+}
+
+static void *hilo_bitacora(void *arg) {
+    bitacora_t *b = arg;
+    uint64_t periodo = (uint64_t)b->resumen_ms * 1000000ull;
+
+    b->resumen_ns = reloj_ns();
+    for (;;) {
+        // cerrar antes que cabeza: si ya se pidió cerrar, la última entrada está a la vista
+        int cerrar = __atomic_load_n(&b->cerrar, __ATOMIC_ACQUIRE);
+        unsigned int cabeza = __atomic_load_n(&b->cabeza, __ATOMIC_ACQUIRE);
+
+        while (b->fin != cabeza) {
+            formatear(b, &b->cola[b->fin & (COLA_ENTRADAS - 1)]);
+            __atomic_store_n(&b->fin, b->fin + 1, __ATOMIC_RELEASE);
+        }
+
+        // Lo descartado se informa agregado en una sola línea
+        uint64_t omitidas = __atomic_load_n(&b->omitidas, __ATOMIC_RELAXED);
+        if (omitidas != b->omitidas_vistas) {
+            AGREGAR(b, COLOR_YELLOW "  [... %llu líneas omitidas, la consola no da abasto]" COLOR_RESET "\n",
+                    (unsigned long long)(omitidas - b->omitidas_vistas));
+            b->omitidas_vistas = omitidas;
+        }
+
+        uint64_t ahora = reloj_ns();
+        if (b->nivel == BITACORA_RESUMEN && (ahora - b->resumen_ns >= periodo || cerrar)) {
+            resumir(b, ahora);
+        }
+        volcar(b);
+
+        if (cerrar) {
+            break;
+        }
+        struct timespec pausa = { 0, SONDEO_BITACORA_MS * 1000000L };
+        nanosleep(&pausa, NULL);
+    }
+    return NULL;
+}
+
+bitacora_t *bitacora_crear(int tipo, int nivel, long resumen_ms) {
+    bitacora_t *b = calloc(1, sizeof(bitacora_t));
+    if (!b) {
+        return NULL;
+    }
+
+    b->tipo = tipo;
+    b->nivel = nivel;
+    b->resumen_ms = resumen_ms;
+    if (nivel == BITACORA_SILENCIO) {
+        return b;  // Sin hilo: solo se cuentan los bytes
+    }
+
+    b->cola = malloc(COLA_ENTRADAS * sizeof(entrada_bitacora_t));
+    b->texto = malloc(TEXTO_BITACORA);
+    if (!b->cola || !b->texto || pthread_create(&b->hilo, NULL, hilo_bitacora, b) != 0) {
+        free(b->cola);
+        free(b->texto);
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+// Cerrar la entrada en curso y sumar n_lote caracteres a los contadores
+void bitacora_enviar(bitacora_t *b, int n_lote) {
+    if (n_lote > 0) {
+        __atomic_store_n(&b->bytes, b->bytes + n_lote, __ATOMIC_RELAXED);
+        __atomic_store_n(&b->lotes, b->lotes + 1, __ATOMIC_RELAXED);
+    }
+
+    entrada_bitacora_t *e = &b->actual;
+    if (e->n == 0) {
+        return;
+    }
+    if (b->tipo == BITACORA_EMISOR) {
+        e->hora = time(NULL);
+    }
+
+    // Con la cola llena la entrada se descarta en vez de esperar al hilo
+    if (b->cabeza - __atomic_load_n(&b->fin, __ATOMIC_ACQUIRE) == COLA_ENTRADAS) {
+        __atomic_store_n(&b->omitidas, b->omitidas + e->n, __ATOMIC_RELAXED);
+    } else {
+        entrada_bitacora_t *destino = &b->cola[b->cabeza & (COLA_ENTRADAS - 1)];
+        destino->n = e->n;
+        destino->hora = e->hora;
+        memcpy(destino->posiciones, e->posiciones, e->n * sizeof(e->posiciones[0]));
+        memcpy(destino->valores, e->valores, e->n);
+        memcpy(destino->latencias_ns, e->latencias_ns, e->n * sizeof(e->latencias_ns[0]));
+        __atomic_store_n(&b->cabeza, b->cabeza + 1, __ATOMIC_RELEASE);
+    }
+    e->n = 0;
+}
+
+// Formatear lo que quede en la cola y liberar
+void bitacora_cerrar(bitacora_t *b) {
+    if (b->nivel != BITACORA_SILENCIO) {
+        bitacora_enviar(b, 0);
+        __atomic_store_n(&b->cerrar, 1, __ATOMIC_RELEASE);
+        pthread_join(b->hilo, NULL);
+    }
+    free(b->cola);
+    free(b->texto);
+    free(b);
+}
@@ -0,0 +1,90 @@
+#ifndef BITACORA_H
+#define BITACORA_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Niveles de detalle de la consola
+#define BITACORA_SILENCIO 0      // Solo los mensajes de inicio y fin
+#define BITACORA_RESUMEN  1      // Una línea cada <ms> con totales y tasa
+#define BITACORA_BYTES    2      // Una línea por carácter (por defecto)
+
+#define RESUMEN_MS_DEFECTO 1000
+
+#define BITACORA_EMISOR   0
+#define BITACORA_RECEPTOR 1
+
+#define ENTRADA_MAX       64     // Caracteres por entrada de la cola
+#define COLA_ENTRADAS     1024   // Capacidad de la cola SPSC (potencia de dos)
+#define SONDEO_BITACORA_MS 10    // Cada cuánto el hilo revisa la cola
+#define TEXTO_BITACORA    65536  // Bytes formateados por fwrite
+
+// Caracteres de un lote tal como se muestran en la consola
+typedef struct {
+    int n;
+    time_t hora;                          // Emisor: segundo de la publicación
+    int64_t posiciones[ENTRADA_MAX];
+    unsigned char valores[ENTRADA_MAX];
+    uint64_t latencias_ns[ENTRADA_MAX];   // Receptor: extremo a extremo
+} entrada_bitacora_t;
+
+/*
+ * Bitácora asíncrona de la consola. El proceso solo copia los caracteres a
+ * una cola SPSC local y suma contadores; un hilo aparte formatea y escribe.
+ * El proceso nunca espera al hilo ni hace llamadas al sistema por él: si
+ * la cola está llena la entrada se descarta y el hilo informa cuántas
+ * líneas se omitieron, así la terminal no frena el anillo.
+ */
+typedef struct {
+    int tipo;
+    int nivel;
+    long resumen_ms;
+
+    // Cola SPSC: cabeza la avanza el proceso, fin el hilo de la bitácora
+    entrada_bitacora_t *cola;
+    unsigned int cabeza;
+    unsigned int fin;
+    int cerrar;
+
+    entrada_bitacora_t actual;    // Entrada en construcción (solo el proceso)
+
+    // Contadores que escribe solo el proceso y lee el hilo
+    uint64_t bytes;
+    uint64_t lotes;
+    uint64_t omitidas;
+
+    // Estado del hilo
+    pthread_t hilo;
+    char *texto;
+    size_t usado;
+    uint64_t omitidas_vistas;
+    uint64_t resumen_bytes;       // Bytes y reloj del último resumen
+    uint64_t resumen_ns;
+    time_t ultimo_segundo;
+    char hora_str[20];
+} bitacora_t;
+
+// Interpretar "bytes", "silencio" o "resumen[/<ms>]"; devuelve -1 si es inválido
+int bitacora_parsear(const char *str, int *nivel, long *resumen_ms);
+void bitacora_describir(int nivel, long resumen_ms, char *buf, size_t len);
+
+bitacora_t *bitacora_crear(int tipo, int nivel, long resumen_ms);
+void bitacora_enviar(bitacora_t *b, int n_lote);
+void bitacora_cerrar(bitacora_t *b);
+
+// Agregar un carácter a la entrada en curso (solo en BITACORA_BYTES)
+static inline void bitacora_agregar(bitacora_t *b, int64_t posicion, unsigned char valor,
+                                    uint64_t latencia_ns) {
+    entrada_bitacora_t *e = &b->actual;
+    if (e->n == ENTRADA_MAX) {
+        bitacora_enviar(b, 0);
+    }
+    e->posiciones[e->n] = posicion;
+    e->valores[e->n] = valor;
+    e->latencias_ns[e->n] = latencia_ns;
+    e->n++;
+}
+
+#endif
@@ -0,0 +1,771 @@
+// canal.c - libcanal: creación, conexión y camino de datos del anillo compartido
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <linux/magic.h>
+#include <linux/mempolicy.h>
+#include "canal.h"
+#include "memoria_compartida.h"
+#include "registros.h"
+
+_Static_assert(CANAL_MUTEX == MODO_ANILLO_MUTEX && CANAL_LOCKFREE == MODO_ANILLO_LOCKFREE &&
+               CANAL_DIFUSION == MODO_ANILLO_DIFUSION && CANAL_REGISTROS == MODO_ANILLO_REGISTROS,
+               "los modos de canal.h deben coincidir con MODO_ANILLO_*");
+_Static_assert(CANAL_AOS == LAYOUT_AOS && CANAL_SOA == LAYOUT_SOA,
+               "los layouts de canal.h deben coincidir con LAYOUT_*");
+_Static_assert(CANAL_EMISOR == PROCESO_EMISOR && CANAL_RECEPTOR == PROCESO_RECEPTOR,
+               "los papeles de canal.h deben coincidir con PROCESO_*");
+_Static_assert(CANAL_MAX_RUTA == MAX_FILENAME && CANAL_LOTE_MAX >= REGISTRO_MAX,
+               "límites de canal.h");
+
+struct canal {
+    shared_mem_t *shm;
+    size_t tamano;
+    int fd;
+    int papel;
+    int carril;
+    proceso_t *yo;            // NULL para los observadores
+    proceso_t *cuenta;        // Registro que suma bytes, lotes y esperas: yo, o el del proceso en un hilo
+    int hist;                 // Histograma de latencia (receptores)
+    espera_t espera;
+    const char *aviso;
+    char nombre[CANAL_MAX_RUTA];
+    canal_t *base;            // Hilos de trabajo: conexión cuyo mapeo comparten
+
+    // canal_aviso_cierre(): eventfd y el hilo que lo marca al empezar la finalización
+    int cierre_fd;
+    pthread_t vigia;
+    int vigia_fin;
+
+    // Modo registros: lo que falta entregar del último registro de canal_recibir_lote()
+    char pendiente[CANAL_LOTE_MAX];
+    int pendiente_len;
+    int pendiente_leido;
+    int64_t pendiente_posicion;
+    uint64_t pendiente_marca;
+};
+
+void canal_config_defecto(canal_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->capacidad = 1024;
+    cfg->modo_anillo = CANAL_MUTEX;
+    cfg->layout = CANAL_AOS;
+    cfg->carriles = 1;
+    cfg->nodo_numa = -1;
+}
+
+// Mutex entre procesos y robusto: si su dueño muere, el siguiente recibe EOWNERDEAD
+static int iniciar_mutex(pthread_mutex_t *mutex) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int r = pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return r == 0 ? 0 : -1;
+}
+
+static canal_t *nuevo_canal(const char *nombre, shared_mem_t *shm, size_t tamano, int fd) {
+    canal_t *c = calloc(1, sizeof(canal_t));
+    if (!c) {
+        perror("Error al reservar el canal");
+        return NULL;
+    }
+    c->shm = shm;
+    c->tamano = tamano;
+    c->fd = fd;
+    c->papel = CANAL_OBSERVADOR;
+    c->cierre_fd = -1;
+    c->espera.politica = ESPERA_BLOQUEO;
+    c->espera.spins = SPINS_POR_DEFECTO;
+    snprintf(c->nombre, sizeof(c->nombre), "%s", nombre);
+    return c;
+}
+
+// Destruir los semáforos y el mutex de los primeros n carriles
+static void destruir_carriles(shared_mem_t *shm, int n) {
+    for (int i = 0; i < n; i++) {
+        sem_destroy(&shm->carriles[i].espacios_libres);
+        sem_destroy(&shm->carriles[i].espacios_ocupados);
+        pthread_mutex_destroy(&shm->carriles[i].mutex);
+    }
+}
+
+/*
+ * Deshacer un canal_crear() a medio hacer. Con el segmento ya mapeado,
+ * destruye además lo que se alcanzó a inicializar: el mutex global si
+ * mutex_listo y los primeros carriles_listos carriles completos.
+ */
+static canal_t *abortar_creacion(const char *nombre, shared_mem_t *shm, size_t tamano, int fd,
+                                 int mutex_listo, int carriles_listos) {
+    if (shm) {
+        destruir_carriles(shm, carriles_listos);
+        if (mutex_listo) {
+            pthread_mutex_destroy(&shm->mutex);
+        }
+        munmap(shm, tamano);
+    }
+    close(fd);
+    eliminar_segmento(nombre);
+    return NULL;
+}
+
+canal_t *canal_crear(const char *nombre, const canal_config_t *cfg) {
+    if (cfg->capacidad <= 0 || cfg->capacidad > BUFFER_MAX) {
+        fprintf(stderr, "Error: El tamaño del buffer debe ser un entero positivo (máx. 2^30)\n");
+        errno = EINVAL;
+        return NULL;
+    }
+    if (cfg->carriles <= 0 || cfg->carriles > MAX_CARRILES) {
+        fprintf(stderr, "Error: Los carriles deben estar entre 1 y %d\n", MAX_CARRILES);
+        errno = EINVAL;
+        return NULL;
+    }
+    if (cfg->nodo_numa < -1 || cfg->nodo_numa >= (long)(8 * sizeof(unsigned long))) {
+        fprintf(stderr, "Error: El nodo NUMA debe ser -1 (sin preferencia) o estar entre 0 y %d\n",
+                (int)(8 * sizeof(unsigned long)) - 1);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Capacidad en potencia de dos: los índices se reducen con una máscara
+    long capacidad = redondear_potencia_dos(cfg->capacidad);
+    long n_carriles = redondear_potencia_dos(cfg->carriles);
+    if (n_carriles > capacidad) {
+        fprintf(stderr, "Error: Se necesita al menos un slot por carril (%ld carriles, %ld slots)\n",
+                n_carriles, capacidad);
+        errno = EINVAL;
+        return NULL;
+    }
+    if (cfg->modo_anillo == MODO_ANILLO_DIFUSION && n_carriles > 1) {
+        fprintf(stderr, "Error: La difusión usa un solo carril (cada receptor lee todo)\n");
+        errno = EINVAL;
+        return NULL;
+    }
+    if (cfg->modo_anillo == MODO_ANILLO_REGISTROS &&
+        (n_carriles > 1 || capacidad < REGISTROS_MIN_BUFFER)) {
+        fprintf(stderr, "Error: El modo registros usa un solo carril de al menos %d bytes\n",
+                REGISTROS_MIN_BUFFER);
+        errno = EINVAL;
+        return NULL;
+    }
+    long carril_size = capacidad / n_carriles;
+    int opciones_segmento = cfg->opciones_segmento;
+
+    // En hugetlbfs el tamaño del segmento debe ser múltiplo de la página grande
+    char ruta_huge[MAX_FILENAME + 64];
+    size_t pagina = 0;
+    if (opciones_segmento & SEGMENTO_HUGETLB) {
+        ruta_hugetlbfs(nombre, ruta_huge, sizeof(ruta_huge));
+        char *barra = strrchr(ruta_huge, '/');
+        *barra = '\0';
+        struct statfs fs;
+        if (statfs(ruta_huge, &fs) == -1 || fs.f_type != HUGETLBFS_MAGIC) {
+            fprintf(stderr, "Error: '%s' no es un montaje hugetlbfs "
+                            "(mount -t hugetlbfs none %s)\n", ruta_huge, ruta_huge);
+            return NULL;
+        }
+        *barra = '/';
+        pagina = (size_t)fs.f_bsize;
+        opciones_segmento &= ~SEGMENTO_THP;
+    }
+
+    size_t buffer_bytes = calcular_buffer_bytes(cfg->layout, cfg->modo_anillo, (int)capacidad);
+    size_t shm_size = alinear_segmento(sizeof(shared_mem_t) + buffer_bytes, pagina);
+
+    // Eliminar memoria compartida previa si existe (en /dev/shm o en hugetlbfs)
+    eliminar_segmento(nombre);
+
+    int shm_fd;
+    if (opciones_segmento & SEGMENTO_HUGETLB) {
+        shm_fd = open(ruta_huge, O_CREAT | O_RDWR | O_EXCL, 0666);
+    } else {
+        shm_fd = shm_open(nombre, O_CREAT | O_RDWR | O_EXCL, 0666);
+    }
+    if (shm_fd == -1) {
+        perror("Error al crear memoria compartida");
+        return NULL;
+    }
+
+    if (ftruncate(shm_fd, shm_size) == -1) {
+        perror("Error al establecer tamaño de memoria compartida");
+        return abortar_creacion(nombre, NULL, 0, shm_fd, 0, 0);
+    }
+
+    shared_mem_t *shm = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (shm == MAP_FAILED) {
+        perror("Error al mapear memoria compartida");
+        if (opciones_segmento & SEGMENTO_HUGETLB) {
+            fprintf(stderr, "¿Hay suficientes huge pages reservadas? (vm.nr_hugepages)\n");
+        }
+        return abortar_creacion(nombre, NULL, 0, shm_fd, 0, 0);
+    }
+
+    // Ligar al nodo antes del primer acceso: el memset ubica las páginas.
+    // La política queda en el objeto compartido y vale para todos los procesos.
+    if (cfg->nodo_numa >= 0) {
+        unsigned long mascara = 1UL << cfg->nodo_numa;
+        if (syscall(SYS_mbind, shm, shm_size, MPOL_BIND, &mascara, sizeof(mascara) * 8, 0) == -1) {
+            perror("Error al ligar el segmento al nodo NUMA");
+            return abortar_creacion(nombre, shm, shm_size, shm_fd, 0, 0);
+        }
+    }
+
+    memset(shm, 0, shm_size);
+
+    // El mutex global y el mutex y los dos semáforos de cada carril
+    if (iniciar_mutex(&shm->mutex) == -1) {
+        perror("Error al inicializar mutex");
+        return abortar_creacion(nombre, shm, shm_size, shm_fd, 0, 0);
+    }
+    for (int i = 0; i < n_carriles; i++) {
+        // Si falla a mitad del carril, deshacer lo suyo aquí y los anteriores al abortar
+        carril_t *carril = &shm->carriles[i];
+        int listos = 0;
+        if (sem_init(&carril->espacios_libres, 1, carril_size) == 0) {
+            listos++;
+            if (sem_init(&carril->espacios_ocupados, 1, 0) == 0) {
+                listos++;
+                if (iniciar_mutex(&carril->mutex) == 0) {
+                    continue;
+                }
+            }
+        }
+        perror("Error al inicializar los semáforos de un carril");
+        if (listos == 2) {
+            sem_destroy(&carril->espacios_ocupados);
+        }
+        if (listos >= 1) {
+            sem_destroy(&carril->espacios_libres);
+        }
+        return abortar_creacion(nombre, shm, shm_size, shm_fd, 1, i);
+    }
+
+    if (cfg->fuente) {
+        strncpy(shm->filename, cfg->fuente, MAX_FILENAME - 1);
+    }
+    if (cfg->salida) {
+        strncpy(shm->output_filename, cfg->salida, MAX_FILENAME - 1);
+    }
+    shm->file_size = cfg->tamano_fuente;
+    shm->buffer_size = (int)capacidad;
+    shm->n_carriles = (int)n_carriles;
+    shm->carril_size = (int)carril_size;
+    shm->carril_mask = (int)carril_size - 1;
+    shm->modo_anillo = cfg->modo_anillo;
+    shm->layout = cfg->layout;
+    shm->opciones_segmento = opciones_segmento;
+    shm->nodo_numa = (int)cfg->nodo_numa;
+    shm->pagina_segmento = pagina;
+
+    if (cfg->modo_anillo == MODO_ANILLO_REGISTROS) {
+        // Cabeceras en cero: el primer registro se reserva con sello 0 en el ticket 0
+    } else if (cfg->layout == LAYOUT_SOA) {
+        // Valores y marcas ya quedaron en cero con el memset
+        if (anillo_con_secuencias(cfg->modo_anillo)) {
+            for (int i = 0; i < capacidad; i++) {
+                soa_secuencias(shm)[i] = i & shm->carril_mask;
+            }
+        }
+    } else {
+        for (int i = 0; i < capacidad; i++) {
+            shm->buffer[i].valor = 0;
+            shm->buffer[i].posicion = -1;
+            shm->buffer[i].timestamp_ns = 0;
+            shm->buffer[i].secuencia = i & shm->carril_mask;
+        }
+    }
+
+    canal_t *c = nuevo_canal(nombre, shm, shm_size, shm_fd);
+    if (!c) {
+        return abortar_creacion(nombre, shm, shm_size, shm_fd, 1, (int)n_carriles);
+    }
+
+    // La cabecera al final: la magia publica un segmento ya inicializado
+    shm->cabecera.version = SEGMENTO_VERSION;
+    shm->cabecera.caracteristicas = caracteristicas_segmento(cfg->modo_anillo, cfg->layout,
+                                                             opciones_segmento);
+    shm->cabecera.tamano_control = sizeof(shared_mem_t);
+    shm->cabecera.tamano_total = shm_size;
+    __atomic_store_n(&shm->cabecera.magia, SEGMENTO_MAGIA, __ATOMIC_RELEASE);
+    return c;
+}
+
+// Registrar a un emisor o receptor; devuelve -1 si no hay registro para su cursor
+static int registrar(canal_t *c, int papel) {
+    shared_mem_t *shm = c->shm;
+
+    if (papel == CANAL_EMISOR) {
+        ajustar_contador(shm, &shm->emisores_activos, 1);
+        c->carril = tomar_carril(shm, &shm->carriles_emisores);
+        c->yo = registrar_proceso(shm, PROCESO_EMISOR, c->carril);
+    } else {
+        // Un receptor drena su carril y roba de los demás cuando está vacío
+        ajustar_contador(shm, &shm->receptores_activos, 1);
+        c->carril = tomar_carril(shm, &shm->carriles_receptores);
+        c->yo = suscribir_proceso(shm, c->carril);
+        if (!c->yo) {
+            fprintf(stderr, "Error: Sin registro libre para el cursor de difusión (máx. %d procesos)\n",
+                    MAX_REGISTROS);
+            ajustar_contador(shm, &shm->receptores_activos, -1);
+            return -1;
+        }
+        c->hist = tomar_histograma(shm);
+    }
+    c->cuenta = c->yo;
+    c->papel = papel;
+    return 0;
+}
+
+canal_t *canal_abrir(const char *nombre, int papel, const espera_t *espera) {
+    // Un fstat y un mmap: la cabecera dice si el segmento es compatible
+    int shm_fd;
+    size_t shm_size;
+    shared_mem_t *shm = adjuntar_segmento(nombre, PROT_READ | PROT_WRITE, &shm_fd, &shm_size);
+    if (!shm) {
+        return NULL;
+    }
+
+    // Los observadores no prefaltan ni bloquean en RAM un buffer que no recorren
+    if (papel != CANAL_OBSERVADOR) {
+        aplicar_opciones_segmento(shm, shm_size, shm->opciones_segmento);
+    }
+
+    canal_t *c = nuevo_canal(nombre, shm, shm_size, shm_fd);
+    if (!c) {
+        munmap(shm, shm_size);
+        close(shm_fd);
+        return NULL;
+    }
+    if (espera) {
+        c->espera = *espera;
+    }
+    if (papel != CANAL_OBSERVADOR && registrar(c, papel) < 0) {
+        canal_cerrar(c);
+        return NULL;
+    }
+    return c;
+}
+
+canal_t *canal_abrir_hilo(canal_t *base) {
+    if (base->papel == CANAL_OBSERVADOR) {
+        fprintf(stderr, "Error: Un observador no tiene hilos de trabajo\n");
+        return NULL;
+    }
+    if (base->papel == CANAL_RECEPTOR && base->shm->modo_anillo == MODO_ANILLO_DIFUSION) {
+        fprintf(stderr, "Error: En difusión cada receptor lee todo; use procesos en lugar de hilos\n");
+        return NULL;
+    }
+
+    canal_t *c = nuevo_canal(base->nombre, base->shm, base->tamano, base->fd);
+    if (!c) {
+        return NULL;
+    }
+    c->base = base;
+    c->espera = base->espera;
+    c->aviso = base->aviso;
+    if (registrar(c, base->papel) < 0) {
+        free(c);
+        return NULL;
+    }
+    // El registro propio guarda la operación en curso; los contadores van al del proceso
+    c->cuenta = base->cuenta;
+    __atomic_store_n(&c->yo->principal, base->yo->principal, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->cuenta->hilos, 1, __ATOMIC_RELAXED);
+    return c;
+}
+
+void canal_cerrar(canal_t *c) {
+    shared_mem_t *shm = c->shm;
+
+    if (c->cierre_fd != -1) {
+        // Los vigías de otros procesos también despiertan, ven que no hay cierre y vuelven a dormir
+        __atomic_store_n(&c->vigia_fin, 1, __ATOMIC_SEQ_CST);
+        __atomic_fetch_add(&shm->epoca_cierre, 1, __ATOMIC_SEQ_CST);
+        futex_despertar(&shm->epoca_cierre);
+        pthread_join(c->vigia, NULL);
+        close(c->cierre_fd);
+    }
+
+    if (c->papel == CANAL_EMISOR) {
+        salir_proceso(c->yo);
+        ajustar_contador(shm, &shm->emisores_activos, -1);
+    } else if (c->papel == CANAL_RECEPTOR) {
+        salir_receptor(shm, c->yo);
+        ajustar_contador(shm, &shm->receptores_activos, -1);
+    }
+    if (!c->base) {
+        munmap(shm, c->tamano);
+        close(c->fd);
+    }
+    free(c);
+}
+
+int canal_destruir(canal_t *c) {
+    shared_mem_t *shm = c->shm;
+    char nombre[CANAL_MAX_RUTA];
+    strncpy(nombre, c->nombre, sizeof(nombre));
+
+    destruir_carriles(shm, shm->n_carriles);
+    pthread_mutex_destroy(&shm->mutex);
+    canal_cerrar(c);
+    return eliminar_segmento(nombre);
+}
+
+void canal_info(const canal_t *c, canal_info_t *info) {
+    const shared_mem_t *shm = c->shm;
+
+    memset(info, 0, sizeof(*info));
+    info->modo_anillo = shm->modo_anillo;
+    info->layout = shm->layout;
+    info->capacidad = shm->buffer_size;
+    info->carriles = shm->n_carriles;
+    info->carril = c->carril;
+    info->cursor = c->yo ? c->yo->cursor : 0;
+    info->registro_max = shm->modo_anillo == MODO_ANILLO_REGISTROS ? registro_max(shm) : 0;
+    info->opciones_segmento = shm->opciones_segmento;
+    info->nodo_numa = shm->nodo_numa;
+    info->pagina = shm->pagina_segmento;
+    info->tamano_segmento = c->tamano;
+    memcpy(info->fuente, shm->filename, sizeof(info->fuente));
+    info->tamano_fuente = shm->file_size;
+    memcpy(info->salida, shm->output_filename, sizeof(info->salida));
+}
+
+void canal_fijar_aviso(canal_t *c, const char *aviso) {
+    c->aviso = aviso;
+}
+
+// Contadores del proceso tras un lote transferido
+static void contar_lote(canal_t *c, int n) {
+    contador_sumar(&c->cuenta->bytes, n);
+    contador_sumar(&c->cuenta->lotes, 1);
+}
+
+// Latencias de un lote en un histograma compartido. Los bytes de un mismo
+// lote publicado comparten la marca, así que los tramos consecutivos que caen
+// en la misma cubeta se vuelcan juntos: unas pocas sumas atómicas por lote en
+// vez de cuatro por byte
+static void registrar_lote(histograma_t *h, const canal_dato_t *datos, int n, uint64_t ahora_ns) {
+    int i = 0;
+    while (i < n) {
+        uint64_t ns = ahora_ns - datos[i].marca_ns;
+        int cubeta = hist_cubeta(ns);
+        uint64_t cuantos = 1, suma = ns, max = ns;
+        for (i++; i < n; i++) {
+            ns = ahora_ns - datos[i].marca_ns;
+            if (hist_cubeta(ns) != cubeta) {
+                break;
+            }
+            cuantos++;
+            suma += ns;
+            max = ns > max ? ns : max;
+        }
+        hist_registrar_cubeta(h, cubeta, cuantos, suma, max);
+    }
+}
+
+int canal_enviar_lote(canal_t *c, const char *datos, int n, int64_t posicion) {
+    shared_mem_t *shm = c->shm;
+    proceso_t *yo = c->yo;
+
+    if (n > CANAL_LOTE_MAX) {
+        n = CANAL_LOTE_MAX;
+    }
+
+    if (shm->modo_anillo == MODO_ANILLO_REGISTROS) {
+        if (n > registro_max(shm)) {
+            n = registro_max(shm);
+        }
+        canal_registro_t r;
+        char *destino = canal_reservar(c, n, &r);
+        if (!destino) {
+            return -1;
+        }
+        memcpy(destino, datos, n);
+        canal_confirmar(c, &r, posicion);
+        return n;
+    }
+
+    if (shm->modo_anillo == MODO_ANILLO_DIFUSION) {
+        // Sin semáforos: cada slot espera al receptor más atrasado
+        marcar_esperando(yo, 1);
+        int primero = difusion_escribir(shm, datos, n, posicion, &c->espera, yo);
+        marcar_esperando(yo, 0);
+        if (primero < 0) {
+            return -1;
+        }
+        contar_lote(c, n);
+        return n;
+    }
+
+    // Reservar el primer slot (espera según la política si el carril está lleno)
+    carril_t *carril = &shm->carriles[c->carril];
+    marcar_esperando(yo, 1);
+    int espera = esperar_unidad(&carril->espacios_libres, &c->espera, &shm->finalizar, c->aviso);
+    marcar_esperando(yo, 0);
+    if (espera < 0) {
+        return -1;
+    }
+    vuelo_unidades(yo, c->carril, 1);
+    if (espera == 1) {
+        contador_sumar(&c->cuenta->esperas, 1);
+        // Verificar de nuevo si debemos finalizar después de despertar
+        if (leer_finalizar(shm)) {
+            publicar_vuelo(&carril->espacios_libres, yo);  // Devolver el semáforo
+            return -1;
+        }
+    }
+
+    // Reservar sin bloquear el resto de los slots contiguos libres
+    int reservados = tomar_vuelo(&carril->espacios_libres, yo, n - 1);
+    if (anillo_escribir(shm, c->carril, datos, reservados, posicion, &c->espera, yo) < 0) {
+        return -1;
+    }
+    publicar_datos(shm, c->carril, yo);  // Commit del tramo
+    contar_lote(c, reservados);
+    return reservados;
+}
+
+int canal_enviar(canal_t *c, const char *datos, int n, int64_t posicion) {
+    int enviados = 0;
+    while (enviados < n) {
+        int r = canal_enviar_lote(c, datos + enviados, n - enviados, posicion + enviados);
+        if (r < 0) {
+            return -1;
+        }
+        enviados += r;
+    }
+    return enviados;
+}
+
+// Modo registros: entregar por bytes lo que queda del último registro recibido
+static int recibir_pendiente(canal_t *c, canal_dato_t *salida, int max) {
+    if (c->pendiente_leido == c->pendiente_len) {
+        canal_registro_t r;
+        const char *datos = canal_tomar(c, &r);
+        if (!datos) {
+            return -1;
+        }
+        memcpy(c->pendiente, datos, r.len);
+        c->pendiente_len = r.len;
+        c->pendiente_leido = 0;
+        c->pendiente_posicion = r.posicion;
+        c->pendiente_marca = r.marca_ns;
+        canal_liberar(c, &r);
+    }
+
+    int n = c->pendiente_len - c->pendiente_leido;
+    if (n > max) {
+        n = max;
+    }
+    for (int i = 0; i < n; i++) {
+        int desde = c->pendiente_leido + i;
+        salida[i].valor = c->pendiente[desde];
+        salida[i].posicion = c->pendiente_posicion < 0 ? -1 : c->pendiente_posicion + desde;
+        salida[i].marca_ns = c->pendiente_marca;
+    }
+    c->pendiente_leido += n;
+    return n;
+}
+
+int canal_recibir_lote(canal_t *c, canal_dato_t *salida, int max) {
+    shared_mem_t *shm = c->shm;
+    proceso_t *yo = c->yo;
+    int durmio;
+    int n;
+
+    if (shm->modo_anillo == MODO_ANILLO_REGISTROS) {
+        return recibir_pendiente(c, salida, max);
+    }
+
+    if (shm->modo_anillo == MODO_ANILLO_DIFUSION) {
+        // Leer desde el cursor propio, sin unidades que tomar ni devolver
+        marcar_esperando(yo, 1);
+        n = difusion_leer(shm, salida, max, &c->espera, yo, &durmio);
+        marcar_esperando(yo, 0);
+        if (n < 0) {
+            return -1;
+        }
+        if (durmio) {
+            contador_sumar(&c->cuenta->esperas, 1);
+        }
+    } else {
+        // Tomar una unidad del carril propio o de otro (espera si todos están vacíos)
+        marcar_esperando(yo, 1);
+        int carril = tomar_dato(shm, c->carril, &c->espera, &durmio, c->aviso);
+        marcar_esperando(yo, 0);
+        if (carril < 0) {
+            return -1;
+        }
+        vuelo_unidades(yo, carril, 1);
+        if (durmio) {
+            contador_sumar(&c->cuenta->esperas, 1);
+            if (leer_finalizar(shm)) {
+                publicar_vuelo(&shm->carriles[carril].espacios_ocupados, yo);
+                return -1;
+            }
+        }
+
+        // Drenar en una pasada todo lo que ya esté disponible (hasta max)
+        n = tomar_vuelo(&shm->carriles[carril].espacios_ocupados, yo, max - 1);
+        if (anillo_leer(shm, carril, salida, n, &c->espera, yo) < 0) {
+            return -1;
+        }
+        publicar_vuelo(&shm->carriles[carril].espacios_libres, yo);
+    }
+
+    // Residencia en el anillo: de la publicación a la lectura
+    registrar_lote(&shm->residencia[c->hist], salida, n, reloj_ns());
+    contar_lote(c, n);
+    return n;
+}
+
+int canal_recibir(canal_t *c, canal_dato_t *dato) {
+    return canal_recibir_lote(c, dato, 1);
+}
+
+char *canal_reservar(canal_t *c, int len, canal_registro_t *r) {
+    marcar_esperando(c->yo, 1);
+    char *destino = registro_reservar(c->shm, len, &c->espera, c->yo, r);
+    marcar_esperando(c->yo, 0);
+    return destino;
+}
+
+void canal_confirmar(canal_t *c, canal_registro_t *r, int64_t posicion) {
+    registro_confirmar(c->shm, r, posicion, c->yo);
+    contar_lote(c, r->len);
+}
+
+const char *canal_tomar(canal_t *c, canal_registro_t *r) {
+    int durmio;
+    marcar_esperando(c->yo, 1);
+    const char *datos = registro_recibir(c->shm, &c->espera, c->yo, r, &durmio);
+    marcar_esperando(c->yo, 0);
+    if (!datos) {
+        return NULL;
+    }
+    if (durmio) {
+        contador_sumar(&c->cuenta->esperas, 1);
+    }
+    hist_registrar(&c->shm->residencia[c->hist], reloj_ns() - r->marca_ns);
+    return datos;
+}
+
+void canal_liberar(canal_t *c, canal_registro_t *r) {
+    registro_liberar(c->shm, r, c->yo);
+    contar_lote(c, r->len);
+}
+
+void canal_entregado(canal_t *c, const canal_dato_t *datos, int n, uint64_t ahora_ns) {
+    registrar_lote(&c->shm->extremo[c->hist], datos, n, ahora_ns);
+}
+
+void canal_registro_entregado(canal_t *c, const canal_registro_t *r, uint64_t ahora_ns) {
+    hist_registrar(&c->shm->extremo[c->hist], ahora_ns - r->marca_ns);
+}
+
+int64_t canal_reclamar(canal_t *c, int n) {
+    return __atomic_fetch_add(&c->shm->file_read_position, n, __ATOMIC_RELAXED);
+}
+
+int64_t canal_posicion_fuente(const canal_t *c) {
+    return __atomic_load_n(&c->shm->file_read_position, __ATOMIC_RELAXED);
+}
+
+int canal_reclamar_hasta(canal_t *c, int64_t *desde, int64_t hasta) {
+    return __atomic_compare_exchange_n(&c->shm->file_read_position, desde, hasta, 0,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+void canal_latir(canal_t *c) {
+    if (c->yo) {
+        latir(c->yo);
+    }
+}
+
+int canal_finalizando(canal_t *c) {
+    return leer_finalizar(c->shm);
+}
+
+double canal_ocupacion(canal_t *c) {
+    shared_mem_t *shm = c->shm;
+    int ocupados;
+
+    if (shm->modo_anillo == MODO_ANILLO_DIFUSION && c->papel == CANAL_RECEPTOR) {
+        ocupados = __atomic_load_n(&shm->carriles[0].write_index, __ATOMIC_ACQUIRE) -
+                   __atomic_load_n(&c->yo->cursor, __ATOMIC_ACQUIRE);
+    } else {
+        ocupados = chars_en_anillo(shm);
+    }
+    if (ocupados <= 0) {
+        return 0;
+    }
+    return ocupados >= shm->buffer_size ? 1 : (double)ocupados / shm->buffer_size;
+}
+
+int *canal_bandera_finalizar(canal_t *c) {
+    return &c->shm->finalizar;
+}
+
+/*
+ * Vigía de canal_aviso_cierre(). despertar_procesos activa finalizar (y
+ * canal_cerrar, vigia_fin) antes de subir epoca_cierre, así que si la época
+ * cambia entre leerla y dormir el futex no duerme, y si ya cambió la bandera
+ * se ve activa: se puede dormir sin plazo.
+ */
+static void *vigilar_cierre(void *arg) {
+    canal_t *c = arg;
+    shared_mem_t *shm = c->shm;
+
+    for (;;) {
+        int epoca = __atomic_load_n(&shm->epoca_cierre, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&shm->finalizar, __ATOMIC_SEQ_CST)) {
+            uint64_t uno = 1;
+            if (write(c->cierre_fd, &uno, sizeof(uno)) != sizeof(uno)) {
+                perror("Error al avisar el cierre");
+            }
+            return NULL;
+        }
+        if (__atomic_load_n(&c->vigia_fin, __ATOMIC_SEQ_CST)) {
+            return NULL;
+        }
+        futex_esperar(&shm->epoca_cierre, epoca);
+    }
+}
+
+int canal_aviso_cierre(canal_t *c) {
+    if (c->base) {
+        return canal_aviso_cierre(c->base);
+    }
+    if (c->cierre_fd != -1) {
+        return c->cierre_fd;
+    }
+    int fd = eventfd(0, EFD_CLOEXEC);
+    if (fd == -1) {
+        perror("Error al crear el aviso de cierre");
+        return -1;
+    }
+    c->cierre_fd = fd;
+    c->vigia_fin = 0;
+    int r = pthread_create(&c->vigia, NULL, vigilar_cierre, c);
+    if (r != 0) {
+        fprintf(stderr, "Error al crear el vigía de cierre: %s\n", strerror(r));
+        close(fd);
+        c->cierre_fd = -1;
+        return -1;
+    }
+    return fd;
+}
+
+struct shared_mem *canal_segmento(canal_t *c) {
+    return c->shm;
+}
@@ -0,0 +1,184 @@
+#ifndef CANAL_H
+#define CANAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "espera.h"
+
+/*
+ * libcanal: el anillo de memoria compartida como biblioteca. Un proceso
+ * crea el canal con canal_crear() y cualquiera se conecta con canal_abrir()
+ * como emisor, receptor u observador; los datos viajan como bytes con su
+ * offset en el flujo (la posición en el archivo, para los programas del
+ * proyecto). La disposición del segmento queda oculta tras canal_t: solo
+ * el supervisor y el monitor usan canal_segmento() para llegar a ella.
+ *
+ * Los enteros devueltos siguen la convención del resto del proyecto: -1
+ * indica error o que se activó la finalización del canal.
+ */
+
+// Modos de sincronización del anillo (mismos valores que MODO_ANILLO_*)
+#define CANAL_MUTEX     0
+#define CANAL_LOCKFREE  1
+#define CANAL_DIFUSION  2
+#define CANAL_REGISTROS 3
+
+// Disposición de los slots
+#define CANAL_AOS 0
+#define CANAL_SOA 1
+
+// Papel de quien se conecta
+#define CANAL_OBSERVADOR 0       // Sin registro: supervisores y herramientas
+#define CANAL_EMISOR     1
+#define CANAL_RECEPTOR   2
+
+#define CANAL_MAX_RUTA 256
+#define CANAL_LOTE_MAX 4096      // Bytes por lote o por registro, como máximo
+
+typedef struct canal canal_t;
+
+// Parámetros de canal_crear(); canal_config_defecto() llena los valores por defecto
+typedef struct {
+    long capacidad;           // Slots (bytes en modo registros); se redondea a potencia de dos
+    int modo_anillo;          // CANAL_MUTEX, CANAL_LOCKFREE, CANAL_DIFUSION o CANAL_REGISTROS
+    int layout;               // CANAL_AOS o CANAL_SOA
+    long carriles;            // Sub-anillos; se redondea a potencia de dos
+    int opciones_segmento;    // SEGMENTO_* de memoria_compartida.h
+    long nodo_numa;           // -1 = sin preferencia; si no, un bit de unsigned long (0..63)
+    const char *fuente;       // Opcional: archivo que reparten los emisores
+    int64_t tamano_fuente;
+    const char *salida;       // Opcional: archivo que reconstruyen los receptores
+} canal_config_t;
+
+// Lo que un proceso conectado puede saber del canal
+typedef struct {
+    int modo_anillo;
+    int layout;
+    int capacidad;
+    int carriles;
+    int carril;               // Carril propio (emisor o receptor)
+    int cursor;               // Difusión: primer ticket que leerá este receptor
+    int registro_max;         // Modo registros: carga útil máxima de un registro
+    int opciones_segmento;
+    int nodo_numa;
+    size_t pagina;            // Página del segmento (huge page en hugetlbfs)
+    size_t tamano_segmento;
+    char fuente[CANAL_MAX_RUTA];
+    int64_t tamano_fuente;
+    char salida[CANAL_MAX_RUTA];
+} canal_info_t;
+
+// Un byte recibido
+typedef struct {
+    int64_t posicion;         // Offset en el flujo (-1 = hueco de un emisor caído)
+    uint64_t marca_ns;        // CLOCK_MONOTONIC al publicarlo
+    char valor;
+} canal_dato_t;
+
+// Registro reservado (emisor) o recibido (receptor) en modo registros
+typedef struct {
+    int ticket;
+    int len;
+    int64_t posicion;
+    uint64_t marca_ns;
+    char *datos;              // Apunta a la memoria compartida
+} canal_registro_t;
+
+void canal_config_defecto(canal_config_t *cfg);
+
+// Crear el segmento (reemplaza uno previo del mismo nombre) y conectarse como
+// observador. Devuelve NULL si falla; con una configuración inválida, errno = EINVAL
+canal_t *canal_crear(const char *nombre, const canal_config_t *cfg);
+
+// Conectarse a un canal existente (falla si su cabecera no es compatible);
+// espera NULL equivale a ESPERA_BLOQUEO
+canal_t *canal_abrir(const char *nombre, int papel, const espera_t *espera);
+
+/*
+ * Otra conexión del mismo proceso para un hilo de trabajo: comparte el
+ * mapeo de base y toma un carril y un registro propios para su operación
+ * en curso; sus bytes, lotes y esperas se suman en el registro del proceso.
+ * Cada hilo usa solo su conexión y la cierra antes que base.
+ */
+canal_t *canal_abrir_hilo(canal_t *base);
+
+// Desregistrarse y desconectarse
+void canal_cerrar(canal_t *c);
+
+// Cerrar y además destruir el canal: semáforos, mutex y el segmento
+int canal_destruir(canal_t *c);
+
+void canal_info(const canal_t *c, canal_info_t *info);
+
+// Mensaje a imprimir cuando un emisor o receptor se bloquea (NULL = en silencio)
+void canal_fijar_aviso(canal_t *c, const char *aviso);
+
+/*
+ * Publicar hasta n bytes consecutivos del flujo desde posicion con una sola
+ * reserva (n <= CANAL_LOTE_MAX). Espera si no hay espacio para el primero
+ * y devuelve cuántos publicó, o -1 si se activó la finalización.
+ */
+int canal_enviar_lote(canal_t *c, const char *datos, int n, int64_t posicion);
+
+// Publicar los n bytes completos, en tantos lotes como haga falta
+int canal_enviar(canal_t *c, const char *datos, int n, int64_t posicion);
+
+/*
+ * Recibir hasta max bytes: espera el primero y agrega los que ya estén
+ * publicados. Devuelve cuántos recibió, o -1 si se activó la finalización.
+ */
+int canal_recibir_lote(canal_t *c, canal_dato_t *salida, int max);
+
+int canal_recibir(canal_t *c, canal_dato_t *dato);
+
+/*
+ * Modo registros, sin copias: el emisor escribe la carga útil en el lugar
+ * entre reservar y confirmar, y el receptor la lee entre tomar y liberar.
+ */
+char *canal_reservar(canal_t *c, int len, canal_registro_t *r);
+void canal_confirmar(canal_t *c, canal_registro_t *r, int64_t posicion);
+const char *canal_tomar(canal_t *c, canal_registro_t *r);
+void canal_liberar(canal_t *c, canal_registro_t *r);
+
+// Registrar la latencia extremo a extremo de lo recibido, ya entregado a su destino
+void canal_entregado(canal_t *c, const canal_dato_t *datos, int n, uint64_t ahora_ns);
+void canal_registro_entregado(canal_t *c, const canal_registro_t *r, uint64_t ahora_ns);
+
+/*
+ * Reparto de la fuente entre emisores: canal_reclamar() toma n bytes con un
+ * fetch-add; canal_reclamar_hasta() mueve la posición de *desde a hasta solo
+ * si nadie la movió antes (si falla, *desde queda con la posición actual).
+ */
+int64_t canal_reclamar(canal_t *c, int n);
+int64_t canal_posicion_fuente(const canal_t *c);
+int canal_reclamar_hasta(canal_t *c, int64_t *desde, int64_t hasta);
+
+// Un ciclo más del proceso: el monitor y el supervisor lo usan para detectar atascos
+void canal_latir(canal_t *c);
+
+int canal_finalizando(canal_t *c);
+
+/*
+ * Fracción del anillo ocupada (0..1): lo publicado y aún no liberado en
+ * todos los carriles; para un receptor de difusión, lo que le falta leer
+ * desde su cursor. Es la señal del modo adaptive de emisor y receptor.
+ */
+double canal_ocupacion(canal_t *c);
+
+// Futex de la finalización, para esperas propias que deban cortarse con ella
+int *canal_bandera_finalizar(canal_t *c);
+
+/*
+ * Descriptor (eventfd) que se vuelve legible cuando empieza la finalización,
+ * para esperas con select o poll como la del modo manual. Lo marca un hilo
+ * que duerme en el futex que sube despertar_procesos. Se crea en la primera
+ * llamada (hacerla antes de abrir hilos de trabajo; los hilos reciben el de
+ * su conexión base) y se cierra con la conexión. Devuelve -1 si falla.
+ */
+int canal_aviso_cierre(canal_t *c);
+
+// Bloque de control del segmento (ver memoria_compartida.h)
+struct shared_mem;
+struct shared_mem *canal_segmento(canal_t *c);
+
+#endif
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "cifrado.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CIFRADO_X86 1
+#endif
+
+static int mcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static void llave_preparar(llave_t *llave) {
+    llave->periodo = llave->len / mcd(llave->len, CIFRADO_PASO) * CIFRADO_PASO;
+    for (int i = 0; i < llave->periodo + CIFRADO_PASO; i++) {
+        llave->flujo[i] = llave->bytes[i % llave->len];
+    }
+}
+
+static int valor_hex(int c) {
+    if (isdigit(c)) {
+        return c - '0';
+    }
+    c = tolower(c);
+    return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+}
+
+int llave_parsear(const char *str, llave_t *llave) {
+    memset(llave, 0, sizeof(*llave));
+
+    if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        const char *hex = str + 2;
+        size_t digitos = strlen(hex);
+        if (digitos == 0 || digitos % 2 != 0 || digitos / 2 > MAX_LLAVE) {
+            return -1;
+        }
+        for (size_t i = 0; i < digitos / 2; i++) {
+            int alto = valor_hex((unsigned char)hex[2 * i]);
+            int bajo = valor_hex((unsigned char)hex[2 * i + 1]);
+            if (alto < 0 || bajo < 0) {
+                return -1;
+            }
+            llave->bytes[i] = (unsigned char)(alto << 4 | bajo);
+        }
+        llave->len = (int)(digitos / 2);
+    } else {
+        char *endptr;
+        long valor = strtol(str, &endptr, 10);
+        if (endptr == str || *endptr != '\0' || valor < 0 || valor > 255) {
+            return -1;
+        }
+        llave->bytes[0] = (unsigned char)valor;
+        llave->len = 1;
+    }
+
+    llave_preparar(llave);
+    return 0;
+}
+
+void llave_describir(const llave_t *llave, char *buf, size_t len) {
+    size_t usado = (size_t)snprintf(buf, len, "0x");
+    for (int i = 0; i < llave->len && usado + 3 < len; i++) {
+        usado += (size_t)snprintf(buf + usado, len - usado, "%02X", llave->bytes[i]);
+    }
+    if (llave->len > 1 && usado < len) {
+        snprintf(buf + usado, len - usado, " (%d bytes)", llave->len);
+    }
+}
+
+static size_t fase_inicial(const llave_t *llave, int64_t offset) {
+    int64_t fase = offset % llave->len;
+    return (size_t)(fase < 0 ? fase + llave->len : fase);
+}
+
+// Palabras de 64 bits: portable, para CPUs sin extensiones conocidas
+static void cifrar_escalar(unsigned char *destino, const unsigned char *origen, size_t n,
+                           const llave_t *llave, int64_t offset) {
+    size_t fase = fase_inicial(llave, offset);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        uint64_t dato, flujo;
+        memcpy(&dato, origen + i, 8);
+        memcpy(&flujo, llave->flujo + fase, 8);
+        dato ^= flujo;
+        memcpy(destino + i, &dato, 8);
+        fase += 8;
+        if (fase >= (size_t)llave->periodo) {
+            fase -= llave->periodo;
+        }
+    }
+    for (; i < n; i++) {
+        destino[i] = origen[i] ^ llave->flujo[fase++];
+    }
+}
+
+#ifdef CIFRADO_X86
+__attribute__((target("sse2")))
+static void cifrar_sse2(unsigned char *destino, const unsigned char *origen, size_t n,
+                        const llave_t *llave, int64_t offset) {
+    size_t fase = fase_inicial(llave, offset);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i flujo = _mm_loadu_si128((const __m128i *)(llave->flujo + fase));
+        __m128i dato = _mm_loadu_si128((const __m128i *)(origen + i));
+        _mm_storeu_si128((__m128i *)(destino + i), _mm_xor_si128(dato, flujo));
+        fase += 16;
+        if (fase >= (size_t)llave->periodo) {
+            fase -= llave->periodo;
+        }
+    }
+    for (; i < n; i++) {
+        destino[i] = origen[i] ^ llave->flujo[fase++];
+    }
+}
+
+__attribute__((target("avx2")))
+static void cifrar_avx2(unsigned char *destino, const unsigned char *origen, size_t n,
+                        const llave_t *llave, int64_t offset) {
+    size_t fase = fase_inicial(llave, offset);
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i flujo = _mm256_loadu_si256((const __m256i *)(llave->flujo + fase));
+        __m256i dato = _mm256_loadu_si256((const __m256i *)(origen + i));
+        _mm256_storeu_si256((__m256i *)(destino + i), _mm256_xor_si256(dato, flujo));
+        fase += 32;
+        if (fase >= (size_t)llave->periodo) {
+            fase -= llave->periodo;
+        }
+    }
+    for (; i < n; i++) {
+        destino[i] = origen[i] ^ llave->flujo[fase++];
+    }
+}
+#endif
+
+static const variante_cifrado_t variantes[] = {
+    { "escalar", cifrar_escalar },
+#ifdef CIFRADO_X86
+    { "sse2", cifrar_sse2 },
+    { "avx2", cifrar_avx2 },
+#endif
+};
+
+int cifrado_variantes(const variante_cifrado_t **lista) {
+    int n = 1;
+#ifdef CIFRADO_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        n = 2;
+        if (__builtin_cpu_supports("avx2")) {
+            n = 3;
+        }
+    }
+#endif
+    *lista = variantes;
+    return n;
+}
+
+void cifrar(unsigned char *destino, const unsigned char *origen, size_t n,
+            const llave_t *llave, int64_t offset) {
+    static cifrar_fn elegida = NULL;
+
+    cifrar_fn fn = __atomic_load_n(&elegida, __ATOMIC_RELAXED);
+    if (!fn) {
+        const variante_cifrado_t *lista;
+        fn = variantes[cifrado_variantes(&lista) - 1].fn;
+        __atomic_store_n(&elegida, fn, __ATOMIC_RELAXED);
+    }
+    fn(destino, origen, n, llave, offset);
+}
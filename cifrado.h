@@ -0,0 +1,45 @@
+#ifndef CIFRADO_H
+#define CIFRADO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_LLAVE     64                        // Bytes de la llave
+#define CIFRADO_PASO  32                        // Bytes por vector (AVX2)
+#define MAX_PERIODO   (63 * CIFRADO_PASO)       // mcm(longitud, paso) en el peor caso
+
+/*
+ * Llave XOR de uno o más bytes. El byte del archivo en el offset o se cifra
+ * con bytes[o % len], así que cada receptor descifra cualquier tramo solo
+ * con su posición. flujo repite la llave hasta un múltiplo del paso más un
+ * vector extra, para que los núcleos SIMD carguen el flujo con una lectura
+ * no alineada desde cualquier fase.
+ */
+typedef struct {
+    unsigned char bytes[MAX_LLAVE];
+    int len;
+    int periodo;                                // mcm(len, CIFRADO_PASO)
+    unsigned char flujo[MAX_PERIODO + CIFRADO_PASO];
+} llave_t;
+
+// destino y origen pueden ser el mismo buffer (cifrado en el lugar)
+typedef void (*cifrar_fn)(unsigned char *destino, const unsigned char *origen, size_t n,
+                          const llave_t *llave, int64_t offset);
+
+typedef struct {
+    const char *nombre;
+    cifrar_fn fn;
+} variante_cifrado_t;
+
+// Interpretar "<0-255>" (un byte) o "0x<hex>" (hasta MAX_LLAVE bytes)
+int llave_parsear(const char *str, llave_t *llave);
+void llave_describir(const llave_t *llave, char *buf, size_t len);
+
+// Variantes utilizables en esta CPU, de la más lenta a la más rápida
+int cifrado_variantes(const variante_cifrado_t **variantes);
+
+// Cifrar/descifrar con la mejor variante disponible (elegida en la primera llamada)
+void cifrar(unsigned char *destino, const unsigned char *origen, size_t n,
+            const llave_t *llave, int64_t offset);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef COLORES_H
+#define COLORES_H
+
+// Códigos de color ANSI
+#define COLOR_RESET   "\x1b[0m"
+#define COLOR_GREEN   "\x1b[32m"
+#define COLOR_CYAN    "\x1b[36m"
+#define COLOR_YELLOW  "\x1b[33m"
+#define COLOR_RED     "\x1b[31m"
+#define COLOR_BLUE    "\x1b[34m"
+#define COLOR_MAGENTA "\x1b[35m"
+#define COLOR_BOLD    "\x1b[1m"
+
+#endif
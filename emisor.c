@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // pthread_setaffinity_np (ver hilos.h)
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,7 +11,11 @@
 #include <signal.h>
 #include <termios.h>
 #include <sys/select.h>
-#include "memoria_compartida.h"
+#include "canal.h"
+#include "colores.h"
+#include "modo_ejecucion.h"
+#include "cifrado.h"
+#include "hilos.h"
 
 
 
@@ -35,16 +40,29 @@ void enable_raw_mode() {
 }
 
 // Esperar por una tecla en modo manual
-int wait_for_keypress() {
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(STDIN_FILENO, &readfds);
-    
+int wait_for_keypress(const int *finalizar, int cierre_fd) {
     printf(COLOR_CYAN "  [Presione cualquier tecla para continuar...]" COLOR_RESET "\r");
     fflush(stdout);
     
-    // select() se bloqueará hasta que haya entrada disponible
-    int result = select(STDIN_FILENO + 1, &readfds, NULL, NULL, NULL);
+    // select() espera la tecla o el aviso de cierre del canal; sin aviso,
+    // espera en tramos cortos para notar la finalización
+    int result = 0;
+    while (result == 0 && !__atomic_load_n(finalizar, __ATOMIC_ACQUIRE)) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(STDIN_FILENO, &readfds);
+        if (cierre_fd >= 0) {
+            FD_SET(cierre_fd, &readfds);
+            result = select((cierre_fd > STDIN_FILENO ? cierre_fd : STDIN_FILENO) + 1,
+                            &readfds, NULL, NULL, NULL);
+            if (result > 0 && FD_ISSET(cierre_fd, &readfds)) {
+                return 0;
+            }
+        } else {
+            struct timeval tramo = { 0, TRAMO_SONDEO_US };
+            result = select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tramo);
+        }
+    }
     
     if (result > 0) {
         char c;
@@ -56,219 +74,363 @@ int wait_for_keypress() {
     return 0;
 }
 
-// Esperar en modo automático
-void wait_automatic(int interval_ms) {
-    usleep(interval_ms * 1000);
+/*
+ * Modo registros: reclamar la próxima línea del archivo (hasta max bytes)
+ * moviendo la posición compartida solo si nadie la movió antes, así las
+ * líneas no se parten entre emisores. Devuelve su largo, o 0 al llegar al
+ * final del archivo.
+ */
+int tomar_linea(canal_t *canal, const unsigned char *archivo, int64_t archivo_size, int max,
+                int64_t *inicio) {
+    int64_t actual = canal_posicion_fuente(canal);
+    for (;;) {
+        if (actual >= archivo_size) {
+            return 0;
+        }
+        int64_t fin = actual + max < archivo_size ? actual + max : archivo_size;
+        const unsigned char *salto = memchr(archivo + actual, '\n', fin - actual);
+        if (salto) {
+            fin = salto - archivo + 1;
+        }
+        if (canal_reclamar_hasta(canal, &actual, fin)) {
+            *inicio = actual;
+            return (int)(fin - actual);
+        }
+    }
+}
+
+// Lo que comparten los hilos de trabajo del emisor (solo lectura)
+typedef struct {
+    llave_t llave;
+    const unsigned char *archivo;
+    int64_t archivo_size;
+    canal_info_t info;
+} emisor_t;
+
+// Un hilo de trabajo: su conexión al canal, su ritmo y su bitácora
+typedef struct {
+    const emisor_t *emisor;
+    const hilos_t *hilos;
+    int indice;
+    canal_t *canal;
+    modo_ejecucion_t modo;
+    bitacora_t *bitacora;
+    long long char_count;
+    pthread_t hilo;
+} trabajador_t;
+
+// Ciclo principal de un hilo: leer y escribir lotes de caracteres
+static void *trabajar(void *arg) {
+    trabajador_t *t = arg;
+    const emisor_t *e = t->emisor;
+    const unsigned char *archivo = e->archivo;
+    int64_t archivo_size = e->archivo_size;
+    canal_t *canal = t->canal;
+    modo_ejecucion_t *modo = &t->modo;
+    bitacora_t *bitacora = t->bitacora;
+
+    fijar_afinidad(t->hilos, t->indice);
+    
+    while (keep_running) {
+        canal_latir(canal);
+
+        // Verificar flag de finalización
+        int debe_finalizar = canal_finalizando(canal);
+        
+        if (debe_finalizar) {
+            printf("\n" COLOR_YELLOW "Emisor: Señal de finalización recibida\n" COLOR_RESET);
+            break;
+        }
+
+        // MODO DE EJECUCIÓN: Esperar según el modo
+        int cuota = modo->lote;
+        if (modo->tipo == MODO_MANUAL) {
+            if (!wait_for_keypress(modo->finalizar, modo->cierre_fd)) {
+                break;
+            }
+        } else {
+            if (toca_regular(modo)) {
+                regular_tasa(modo, canal_ocupacion(canal));
+            }
+            if ((cuota = esperar_turno(modo)) == 0) {
+                continue;  // Pausa cortada por la finalización
+            }
+        }
+
+        if (e->info.modo_anillo == CANAL_REGISTROS) {
+            // Una línea por ciclo, cifrada directo en el espacio reservado del anillo
+            int64_t inicio;
+            int len = tomar_linea(canal, archivo, archivo_size, e->info.registro_max, &inicio);
+            if (len == 0) {
+                printf("\n" COLOR_YELLOW "Emisor: Fin del archivo alcanzado\n" COLOR_RESET);
+                break;
+            }
+
+            canal_registro_t registro;
+            char *destino = canal_reservar(canal, len, &registro);
+            if (!destino) {
+                break;
+            }
+            cifrar((unsigned char *)destino, archivo + inicio, len, &e->llave, inicio);
+            canal_confirmar(canal, &registro, inicio);
+
+            if (modo->bitacora == BITACORA_BYTES) {
+                for (int i = 0; i < len; i++) {
+                    bitacora_agregar(bitacora, inicio + i, archivo[inicio + i], 0);
+                }
+            }
+            bitacora_enviar(bitacora, len);
+            t->char_count += len;
+            consumir_turno(modo, len);
+            continue;
+        }
+        
+        // Reclamar un rango del archivo con un fetch-add atómico
+        int64_t inicio = canal_reclamar(canal, cuota);
+        
+        if (inicio >= archivo_size) {
+            // Fin del archivo alcanzado
+            printf("\n" COLOR_YELLOW "Emisor: Fin del archivo alcanzado\n" COLOR_RESET);
+            break;
+        }
+        
+        int leidos = cuota;
+        if (inicio + leidos > archivo_size) {
+            leidos = (int)(archivo_size - inicio);
+        }
+        const unsigned char *lote = archivo + inicio;
+
+        // Cifrar el lote completo antes de reservar slots, fuera de toda sección
+        // crítica. No se cifra sobre los slots: en AOS cada byte va intercalado
+        // con sus metadatos, en MUTEX se escriben con el candado tomado y el
+        // anillo puede dar la vuelta a mitad del lote. La copia queda en L1.
+        char encrypted[MAX_LOTE];
+        cifrar((unsigned char *)encrypted, lote, leidos, &e->llave, inicio);
+        
+        // Publicar el lote; si no hay espacio para todo, en varios tramos
+        int enviados = 0;
+        while (enviados < leidos) {
+            int64_t posicion = inicio + enviados;
+            int n = canal_enviar_lote(canal, encrypted + enviados, leidos - enviados, posicion);
+            if (n < 0) {
+                debe_finalizar = 1;
+                break;
+            }
+            
+            // Encolar los caracteres escritos para la consola
+            if (modo->bitacora == BITACORA_BYTES) {
+                for (int i = 0; i < n; i++) {
+                    bitacora_agregar(bitacora, posicion + i, lote[enviados + i], 0);
+                }
+            }
+            bitacora_enviar(bitacora, n);
+            
+            enviados += n;
+            t->char_count += n;
+        }
+
+        consumir_turno(modo, enviados);
+
+        if (debe_finalizar) {
+            break;
+        }
+    }
+    return NULL;
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Uso: %s <identificador_shm> <llave_encriptacion> <modo>\n", argv[0]);
+    if (argc < 4) {
+        fprintf(stderr, "Uso: %s <identificador_shm> <llave_encriptacion> <modo> [--threads=<n>] [--cpus=<lista>]\n", argv[0]);
         fprintf(stderr, "Modos:\n");
-        fprintf(stderr, "  auto:<milisegundos>\n");
-        fprintf(stderr, "  manual\n");
+        fprintf(stderr, "  auto:<milisegundos>[:batch=<n>][:espera=<política>]   (auto:0 = max)\n");
+        fprintf(stderr, "  max[:batch=<n>][:espera=<política>]\n");
+        fprintf(stderr, "  rate:<bytes_por_seg>[k|M|G][:batch=<n>][:espera=<política>]\n");
+        fprintf(stderr, "  adaptive[:<objetivo>%%][:batch=<n>][:espera=<política>]   (objetivo: %d%% del anillo)\n",
+                OBJETIVO_DEFECTO);
+        fprintf(stderr, "  manual[:batch=<n>][:espera=<política>]\n");
+        fprintf(stderr, "Políticas de espera: bloqueo (por defecto), spin, adaptativa[/<spins>]\n");
+        fprintf(stderr, "Consola (:log=): bytes (por defecto), resumen[/<ms>], silencio\n");
+        fprintf(stderr, "Llave: un byte (0-255) o varios en hexadecimal, ej: 0x2A7F10\n");
+        fprintf(stderr, "Hilos: --threads=<n> ciclos de envío en un proceso (máx. %d), --cpus=0,2-3 afinidad\n",
+                MAX_HILOS);
         fprintf(stderr, "\nEjemplos:\n");
-        fprintf(stderr, "  %s /mi_memoria 42 auto:1000    # Escribir cada 1 segundo\n", argv[0]);
-        fprintf(stderr, "  %s /mi_memoria 42 manual       # Escribir al presionar tecla\n", argv[0]);
+        fprintf(stderr, "  %s /mi_memoria 42 auto:1000          # Escribir cada 1 segundo\n", argv[0]);
+        fprintf(stderr, "  %s /mi_memoria 42 auto:10:batch=64   # Hasta 64 caracteres por ciclo\n", argv[0]);
+        fprintf(stderr, "  %s /mi_memoria 42 max:batch=256      # Sin pausas, lo más rápido posible\n", argv[0]);
+        fprintf(stderr, "  %s /mi_memoria 42 rate:10M:batch=256 # 10 MB/s con balde de fichas\n", argv[0]);
+        fprintf(stderr, "  %s /mi_memoria 42 adaptive:30%%:batch=256  # Tasa según la ocupación del anillo\n", argv[0]);
+        fprintf(stderr, "  %s /mi_memoria 42 max:log=resumen    # Una línea de totales por segundo\n", argv[0]);
+        fprintf(stderr, "  %s /mi_memoria 42 manual             # Escribir al presionar tecla\n", argv[0]);
+        fprintf(stderr, "  %s /mi_memoria 42 max --threads=4 --cpus=0-3  # Cuatro hilos fijos\n", argv[0]);
         return 1;
     }
 
     const char *shm_name = argv[1];
-    unsigned char llave = (unsigned char)atoi(argv[2]);
-    char *modo_str = argv[3];
+    llave_t llave;
+    if (llave_parsear(argv[2], &llave) < 0) {
+        fprintf(stderr, "Error: Llave inválida. Use un byte (0-255) o '0x<hex>' (hasta %d bytes)\n",
+                MAX_LLAVE);
+        return 1;
+    }
+    char llave_str[2 * MAX_LLAVE + 32];
+    llave_describir(&llave, llave_str, sizeof(llave_str));
 
-    //valores default
-    int modo_automatico = 0;
-    int intervalo_ms = 1000;
-    
     //verifica cual modo se escoge
-    if (strncmp(modo_str, "auto:", 5) == 0) {
-        modo_automatico = 1;
-        intervalo_ms = atoi(modo_str + 5);
-        if (intervalo_ms <= 0) {
-            fprintf(stderr, "Error: Intervalo debe ser positivo\n");
+    modo_ejecucion_t modo;
+    if (parsear_modo(argv[3], &modo) < 0) {
+        return 1;
+    }
+    modo.sentido = SENTIDO_EMISOR;
+
+    hilos_t hilos;
+    hilos_defecto(&hilos);
+    for (int i = 4; i < argc; i++) {
+        if (parsear_opcion_hilos(argv[i], &hilos) < 0) {
             return 1;
         }
-    } else if (strcmp(modo_str, "manual") == 0) {
-        modo_automatico = 0;
-    } else {
-        fprintf(stderr, "Error: Modo inválido. Use 'auto:<ms>' o 'manual'\n");
+    }
+    if (modo.tipo == MODO_MANUAL && hilos.n > 1) {
+        fprintf(stderr, "Error: El modo manual usa un solo hilo\n");
         return 1;
     }
     
     printf("=== Emisor iniciado ===\n");
-    printf("Llave de encriptación: 0x%02X\n", llave);
-    if (modo_automatico) {
-        printf("Modo: " COLOR_GREEN "AUTOMÁTICO" COLOR_RESET " (intervalo: %d ms)\n\n", intervalo_ms);
+    printf("Llave de encriptación: %s\n", llave_str);
+    if (modo.tipo == MODO_AUTO) {
+        printf("Modo: " COLOR_GREEN "AUTOMÁTICO" COLOR_RESET " (intervalo: %d ms)\n", modo.intervalo_ms);
+    } else if (modo.tipo == MODO_MAX) {
+        printf("Modo: " COLOR_GREEN "MÁXIMO" COLOR_RESET " (sin pausas)\n");
+    } else if (modo.tipo == MODO_TASA) {
+        printf("Modo: " COLOR_GREEN "TASA" COLOR_RESET " (%.0f bytes/s)\n", modo.tasa);
+    } else if (modo.tipo == MODO_ADAPTATIVO) {
+        printf("Modo: " COLOR_GREEN "ADAPTATIVO" COLOR_RESET " (objetivo: %.0f%% del anillo ocupado)\n",
+               modo.objetivo * 100);
     } else {
-        printf("Modo: " COLOR_YELLOW "MANUAL" COLOR_RESET " (presionar tecla para escribir)\n\n");
+        printf("Modo: " COLOR_YELLOW "MANUAL" COLOR_RESET " (presionar tecla para escribir)\n");
         enable_raw_mode();
     }
+    printf("Lote: %d caracteres por ciclo\n", modo.lote);
+    char bitacora_str[64];
+    bitacora_describir(modo.bitacora, modo.resumen_ms, bitacora_str, sizeof(bitacora_str));
+    printf("Espera: %s\n", nombre_espera(&modo.espera));
+    char hilos_str[512];
+    hilos_describir(&hilos, hilos_str, sizeof(hilos_str));
+    printf("Consola: %s\n", bitacora_str);
+    printf("Hilos: %s\n\n", hilos_str);
 
-    // Abrir memoria compartida
-    int shm_fd = shm_open(shm_name, O_RDWR, 0666);
-    if (shm_fd == -1) {
-        perror("Error: No se puede abrir la memoria compartida");
-        fprintf(stderr, "¿Ejecutó el inicializador primero?\n");
-        return 1;
-    }
-
-    // Mapear memoria compartida temporal (no se conoce el tamaño)
-    size_t base_size = sizeof(shared_mem_t);
-    shared_mem_t *shm_temp = mmap(NULL, base_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-
-    if (shm_temp == MAP_FAILED) {
-        perror("Error al mapear memoria compartida (temporal)");
-        close(shm_fd);
+    // Conectarse al canal como emisor
+    canal_t *canal = canal_abrir(shm_name, CANAL_EMISOR, &modo.espera);
+    if (!canal) {
         return 1;
     }
-
-    int buffer_size = shm_temp->buffer_size;
-    char filename[MAX_FILENAME];
-    strncpy(filename, shm_temp->filename, MAX_FILENAME);
-
-    munmap(shm_temp, base_size);
-
-    // vuelve a abrir memoria compartida con tamaño correcto
-    size_t shm_size = sizeof(shared_mem_t) + (buffer_size * sizeof(char_info_t));
-    shared_mem_t *shm = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    
-    if (shm == MAP_FAILED) {
-        perror("Error al mapear memoria compartida (completa)");
-        close(shm_fd);
-        return 1;
+    canal_info_t info;
+    canal_info(canal, &info);
+    modo.finalizar = canal_bandera_finalizar(canal);
+    if (modo.tipo == MODO_MANUAL) {
+        modo.cierre_fd = canal_aviso_cierre(canal);  // Antes de abrir los hilos de trabajo
     }
+    printf("Carril: %d de %d\n", info.carril, info.carriles);
 
-    // Registrar este emisor
-    sem_wait(&shm->mutex);
-    shm->emisores_activos++;
-    sem_post(&shm->mutex);
-
-    // Abrir el archivo fuente
-    FILE *archivo = fopen(filename, "r");
-    if (!archivo) {
+    // Mapear el archivo fuente en modo solo lectura
+    int archivo_fd = open(info.fuente, O_RDONLY);
+    struct stat archivo_st;
+    if (archivo_fd == -1 || fstat(archivo_fd, &archivo_st) == -1) {
         perror("Error al abrir archivo fuente");
-        sem_wait(&shm->mutex);
-        shm->emisores_activos--;
-        sem_post(&shm->mutex);
-        munmap(shm, shm_size);
-        close(shm_fd);
+        if (archivo_fd != -1) {
+            close(archivo_fd);
+        }
+        canal_cerrar(canal);
         return 1;
     }
 
-    printf("\n" COLOR_CYAN "%-10s %-8s %-10s %-20s" COLOR_RESET "\n", 
-           "Carácter", "ASCII", "Posición", "Timestamp");
-    printf("--------------------------------------------------------\n");
+    int64_t archivo_size = archivo_st.st_size;
+    const unsigned char *archivo = NULL;
+    if (archivo_size > 0) {
+        archivo = mmap(NULL, archivo_size, PROT_READ, MAP_PRIVATE, archivo_fd, 0);
+        if (archivo == MAP_FAILED) {
+            perror("Error al mapear archivo fuente");
+            close(archivo_fd);
+            canal_cerrar(canal);
+            return 1;
+        }
+        madvise((void *)archivo, archivo_size, MADV_SEQUENTIAL);
+    }
+    close(archivo_fd);  // El mapeo se mantiene tras cerrar el descriptor
 
-    // Ciclo principal: leer y escribir caracteres
-    int char_count = 0;
-    
-    while (keep_running) {
-        // Verificar flag de finalización
-        sem_wait(&shm->mutex);
-        int debe_finalizar = shm->finalizar;
-        sem_post(&shm->mutex);
-        
-        if (debe_finalizar) {
-            printf("\n" COLOR_YELLOW "Emisor: Señal de finalización recibida\n" COLOR_RESET);
+    /*
+     * El hilo principal es el trabajador 0 y usa la conexión del proceso;
+     * los demás abren la suya sobre el mismo mapeo. Cada uno tiene su
+     * bitácora (la cola hacia la consola es de un solo productor).
+     */
+    emisor_t emisor = { llave, archivo, archivo_size, info };
+    trabajador_t trabajadores[MAX_HILOS];
+    int n_trabajadores = 0;
+    int error = 0;
+    for (int i = 0; i < hilos.n && !error; i++) {
+        trabajador_t *t = &trabajadores[i];
+        memset(t, 0, sizeof(*t));
+        t->emisor = &emisor;
+        t->hilos = &hilos;
+        t->indice = i;
+        t->modo = modo;
+        t->canal = i == 0 ? canal : canal_abrir_hilo(canal);
+        if (!t->canal) {
+            error = 1;
             break;
         }
-
-        // MODO DE EJECUCIÓN: Esperar según el modo
-        if (modo_automatico) {
-            wait_automatic(intervalo_ms);
-        } else {
-            if (!wait_for_keypress()) {
-                break;
+        // La consola la escribe un hilo aparte; el ciclo solo encola
+        t->bitacora = bitacora_crear(BITACORA_EMISOR, modo.bitacora, modo.resumen_ms);
+        if (!t->bitacora) {
+            perror("Error al iniciar la bitácora");
+            if (i > 0) {
+                canal_cerrar(t->canal);
             }
-        }
-        
-        // coordinación para leer del archivo
-        sem_wait(&shm->file_mutex);
-        
-        // Ir a la posición compartida
-        if (fseek(archivo, shm->file_read_position, SEEK_SET) != 0) {
-            sem_post(&shm->file_mutex);
-            perror("Error en fseek");
+            error = 1;
             break;
         }
-        
-        // Leer UN carácter
-        int c = fgetc(archivo);
-        
-        if (c == EOF) {
-            // Fin del archivo alcanzado
-            sem_post(&shm->file_mutex);
-            printf("\n" COLOR_YELLOW "Emisor: Fin del archivo alcanzado\n" COLOR_RESET);
-            break;
+        if (modo.bitacora == BITACORA_BYTES) {
+            canal_fijar_aviso(t->canal, COLOR_RED "Buffer lleno, esperando espacio...\n" COLOR_RESET);
         }
-        
-        // Avanzar la posición compartida
-        shm->file_read_position++;
-        
-        sem_post(&shm->file_mutex);  // ← Liberar mutex del archivo
-        // ===== FIN DE COORDINACIÓN =====
-        
-        // Ahora intentar escribir en el buffer
-        if (sem_trywait(&shm->espacios_libres) == -1) {
-            if (errno == EAGAIN) {
-                printf(COLOR_RED "Buffer lleno, esperando espacio...\n" COLOR_RESET);
-                sem_wait(&shm->espacios_libres);
-                
-                // Verificar de nuevo si debemos finalizar después de despertar
-                sem_wait(&shm->mutex);
-                debe_finalizar = shm->finalizar;
-                sem_post(&shm->mutex);
-                
-                if (debe_finalizar) {
-                    sem_post(&shm->espacios_libres);  // Devolver el semáforo
-                    break;
-                }
-            } else {
-                perror("Error en sem_trywait");
+        n_trabajadores++;
+    }
+
+    if (!error && modo.bitacora == BITACORA_BYTES) {
+        printf("\n" COLOR_CYAN "%-10s %-8s %-10s %-20s" COLOR_RESET "\n", 
+               "Carácter", "ASCII", "Posición", "Timestamp");
+        printf("--------------------------------------------------------\n");
+    }
+
+    int lanzados = 1;
+    if (!error) {
+        for (; lanzados < n_trabajadores; lanzados++) {
+            if (pthread_create(&trabajadores[lanzados].hilo, NULL, trabajar,
+                               &trabajadores[lanzados]) != 0) {
+                perror("Error al crear un hilo de trabajo");
                 break;
             }
         }
-        
-        // Obtener acceso exclusivo a los índices del buffer
-        sem_wait(&shm->mutex);
-        
-        int pos = shm->write_index % buffer_size;
-        unsigned char encrypted = (unsigned char)c ^ llave;
-        
-        shm->buffer[pos].valor = encrypted;
-        shm->buffer[pos].posicion = shm->write_index;
-        shm->buffer[pos].timestamp = time(NULL);
-        
-        shm->write_index++;
-        shm->chars_transferidos++;
-        
-        sem_post(&shm->mutex);
-        sem_post(&shm->espacios_ocupados);
-        
-        // Mostrar información del carácter escrito
-        char display_char = (c >= 32 && c < 127) ? c : '.';
-        struct tm *tm_info = localtime(&shm->buffer[pos].timestamp);
-        char time_str[20];
-        strftime(time_str, sizeof(time_str), "%H:%M:%S", tm_info);
-        
-        printf(COLOR_GREEN "'%c'" COLOR_RESET "        %-8d %-10d %s\n", 
-               display_char, c, shm->buffer[pos].posicion, time_str);
-        
-        char_count++;
+        trabajar(&trabajadores[0]);
     }
 
-    fclose(archivo);
+    long long char_count = 0;
+    for (int i = 0; i < n_trabajadores; i++) {
+        if (i > 0 && i < lanzados) {
+            pthread_join(trabajadores[i].hilo, NULL);
+        }
+        bitacora_cerrar(trabajadores[i].bitacora);
+        if (i > 0) {
+            canal_cerrar(trabajadores[i].canal);  // Antes que la conexión del proceso
+        }
+        char_count += trabajadores[i].char_count;
+    }
+    if (archivo) {
+        munmap((void *)archivo, archivo_size);
+    }
 
-    printf("\n" COLOR_YELLOW "Emisor finalizó: %d caracteres escritos" COLOR_RESET "\n", char_count);
+    printf("\n" COLOR_YELLOW "Emisor finalizó: %lld caracteres escritos" COLOR_RESET "\n", char_count);
 
     // Desregistrar este emisor
-    sem_wait(&shm->mutex);
-    shm->emisores_activos--;
-    sem_post(&shm->mutex);
+    canal_cerrar(canal);
 
-    munmap(shm, shm_size);
-    close(shm_fd);
-
-    return 0;
-}
\ No newline at end of file
+    return error;
+}
@@ -0,0 +1,253 @@
+#define _GNU_SOURCE  // sem_clockwait
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include "escritor_salida.h"
+
+int escritor_parsear(const char *str, int *politica, long *umbral) {
+    char *endptr;
+
+    if (strcmp(str, "cierre") == 0) {
+        *politica = FLUSH_CIERRE;
+        *umbral = 0;
+        return 0;
+    }
+    if (strncmp(str, "bytes:", 6) == 0) {
+        *politica = FLUSH_BYTES;
+        *umbral = strtol(str + 6, &endptr, 10);
+    } else if (strncmp(str, "ms:", 3) == 0) {
+        *politica = FLUSH_TIEMPO;
+        *umbral = strtol(str + 3, &endptr, 10);
+    } else {
+        return -1;
+    }
+    if (*endptr != '\0' || *umbral <= 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Plazo de la política de tiempo: llegada del primer pendiente más <umbral> ms (CLOCK_MONOTONIC)
+static struct timespec plazo_vaciado(const escritor_t *e) {
+    struct timespec plazo = e->desde;
+    plazo.tv_sec += e->umbral / 1000;
+    plazo.tv_nsec += (e->umbral % 1000) * 1000000L;
+    if (plazo.tv_nsec >= 1000000000L) {
+        plazo.tv_sec++;
+        plazo.tv_nsec -= 1000000000L;
+    }
+    return plazo;
+}
+
+static int plazo_vencido(const struct timespec *plazo) {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return ahora.tv_sec > plazo->tv_sec ||
+           (ahora.tv_sec == plazo->tv_sec && ahora.tv_nsec >= plazo->tv_nsec);
+}
+
+static void escribir_todo(escritor_t *e, const unsigned char *datos, long len, int64_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(e->fd, datos, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("Error al escribir la salida");
+            return;
+        }
+        e->escrituras++;
+        datos += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+// Escribir los pendientes uniendo tramos contiguos en un solo pwrite
+static void vaciar(escritor_t *e) {
+    int64_t inicio = 0;
+    long len = 0;
+
+    for (int i = 0; i < e->n_pendientes; i++) {
+        tramo_t *t = &e->pendientes[i];
+        if (len > 0 && (t->offset != inicio + len || len + t->len > BUFFER_ESCRITURA)) {
+            escribir_todo(e, e->buffer, len, inicio);
+            len = 0;
+        }
+        if (len == 0) {
+            inicio = t->offset;
+        }
+        memcpy(e->buffer + len, t->datos, t->len);
+        len += t->len;
+    }
+    if (len > 0) {
+        escribir_todo(e, e->buffer, len, inicio);
+    }
+
+    e->n_pendientes = 0;
+    e->bytes_pendientes = 0;
+}
+
+static int debe_vaciar(escritor_t *e) {
+    if (e->n_pendientes == MAX_PENDIENTES) {
+        return 1;
+    }
+    switch (e->politica) {
+    case FLUSH_BYTES:
+        return e->bytes_pendientes >= e->umbral;
+    case FLUSH_TIEMPO:
+        if (e->n_pendientes == 0) {
+            return 0;
+        }
+        struct timespec plazo = plazo_vaciado(e);
+        return plazo_vencido(&plazo);
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Si el receptor duerme con la cola llena, publicarle un lugar. Se hace al
+ * vaciar la cola o antes de bloquearse en el disco, no por cada tramo, para
+ * que despierte una vez con mucho lugar libre y no una vez por tramo.
+ */
+static void despertar_receptor(escritor_t *e) {
+    if (__atomic_exchange_n(&e->esperando_lugar, 0, __ATOMIC_SEQ_CST)) {
+        sem_post(&e->hay_lugar);
+    }
+}
+
+static void *hilo_escritor(void *arg) {
+    escritor_t *e = arg;
+
+    for (;;) {
+        unsigned int cabeza = __atomic_load_n(&e->cabeza, __ATOMIC_ACQUIRE);
+
+        while (e->fin != cabeza) {
+            tramo_t *t = &e->cola[e->fin & (COLA_TRAMOS - 1)];
+            if (e->n_pendientes == 0) {
+                clock_gettime(CLOCK_MONOTONIC, &e->desde);
+            }
+            e->pendientes[e->n_pendientes++] = *t;
+            e->bytes_pendientes += t->len;
+            __atomic_store_n(&e->fin, e->fin + 1, __ATOMIC_SEQ_CST);
+
+            if (debe_vaciar(e)) {
+                despertar_receptor(e);  // Que siga encolando mientras se escribe
+                vaciar(e);
+            }
+        }
+        despertar_receptor(e);
+
+        if (__atomic_load_n(&e->cerrar, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&e->cabeza, __ATOMIC_ACQUIRE) == e->fin) {
+            break;
+        }
+        if (debe_vaciar(e)) {
+            vaciar(e);
+        }
+
+        // Dormir hasta que haya datos o, con pendientes y política de tiempo,
+        // hasta su plazo. El reloj monotónico no salta con la hora del sistema
+        if (e->politica == FLUSH_TIEMPO && e->n_pendientes > 0) {
+            struct timespec plazo = plazo_vaciado(e);
+            sem_clockwait(&e->hay_datos, CLOCK_MONOTONIC, &plazo);
+        } else {
+            sem_wait(&e->hay_datos);
+        }
+    }
+
+    vaciar(e);
+    return NULL;
+}
+
+escritor_t *escritor_crear(const char *ruta, int politica, long umbral) {
+    escritor_t *e = calloc(1, sizeof(escritor_t));
+    if (!e) {
+        return NULL;
+    }
+
+    e->fd = -1;
+    e->politica = politica;
+    e->umbral = umbral;
+    e->pendientes = malloc(MAX_PENDIENTES * sizeof(tramo_t));
+    e->buffer = malloc(BUFFER_ESCRITURA);
+    if (e->pendientes && e->buffer) {
+        e->fd = open(ruta, O_WRONLY);
+    }
+    if (e->fd == -1) {
+        goto error;
+    }
+
+    sem_init(&e->hay_datos, 0, 0);
+    sem_init(&e->hay_lugar, 0, 0);
+    if (pthread_create(&e->hilo, NULL, hilo_escritor, e) != 0) {
+        sem_destroy(&e->hay_datos);
+        sem_destroy(&e->hay_lugar);
+        goto error;
+    }
+    return e;
+
+error:
+    if (e->fd != -1) {
+        close(e->fd);
+    }
+    free(e->pendientes);
+    free(e->buffer);
+    free(e);
+    return NULL;
+}
+
+void escritor_enviar(escritor_t *e) {
+    if (e->actual.len == 0) {
+        return;
+    }
+
+    // Si la cola está llena dormir hasta que el hilo escritor libere un lugar.
+    // La marca y fin se escriben y leen en orden secuencialmente consistente:
+    // o el escritor ve la marca y publica, o aquí ya se ve el lugar libre
+    while (e->cabeza - __atomic_load_n(&e->fin, __ATOMIC_ACQUIRE) == COLA_TRAMOS) {
+        __atomic_store_n(&e->esperando_lugar, 1, __ATOMIC_SEQ_CST);
+        if (e->cabeza - __atomic_load_n(&e->fin, __ATOMIC_SEQ_CST) == COLA_TRAMOS) {
+            sem_wait(&e->hay_lugar);
+        }
+    }
+
+    e->cola[e->cabeza & (COLA_TRAMOS - 1)] = e->actual;
+    __atomic_store_n(&e->cabeza, e->cabeza + 1, __ATOMIC_RELEASE);
+    sem_post(&e->hay_datos);
+
+    e->actual.len = 0;
+}
+
+void escritor_agregar(escritor_t *e, int64_t offset, unsigned char valor) {
+    tramo_t *t = &e->actual;
+
+    if (t->len > 0 && (t->offset + t->len != offset || t->len == TRAMO_MAX)) {
+        escritor_enviar(e);
+    }
+    if (t->len == 0) {
+        t->offset = offset;
+    }
+    t->datos[t->len++] = valor;
+}
+
+// Vaciar todo lo pendiente y liberar; devuelve el número de pwrite realizadas
+long long escritor_cerrar(escritor_t *e) {
+    escritor_enviar(e);
+    __atomic_store_n(&e->cerrar, 1, __ATOMIC_RELEASE);
+    sem_post(&e->hay_datos);
+    pthread_join(e->hilo, NULL);
+
+    long long escrituras = e->escrituras;
+    sem_destroy(&e->hay_datos);
+    sem_destroy(&e->hay_lugar);
+    close(e->fd);
+    free(e->pendientes);
+    free(e->buffer);
+    free(e);
+    return escrituras;
+}
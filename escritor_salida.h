@@ -0,0 +1,65 @@
+#ifndef ESCRITOR_SALIDA_H
+#define ESCRITOR_SALIDA_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <time.h>
+
+#define TRAMO_MAX       512      // Bytes contiguos por tramo
+#define COLA_TRAMOS     256      // Capacidad de la cola SPSC (potencia de dos)
+#define MAX_PENDIENTES  1024     // Tramos acumulados antes de forzar escritura
+#define BUFFER_ESCRITURA 65536   // Bytes contiguos por pwrite
+
+// Políticas de vaciado del escritor
+#define FLUSH_BYTES  0           // Escribir al acumular <umbral> bytes
+#define FLUSH_TIEMPO 1           // Escribir cada <umbral> milisegundos
+#define FLUSH_CIERRE 2           // Escribir solo al cerrar (o si se llena)
+
+// Bytes consecutivos de la salida que empiezan en offset
+typedef struct {
+    int64_t offset;
+    int len;
+    unsigned char datos[TRAMO_MAX];
+} tramo_t;
+
+/*
+ * Escritor asíncrono de la salida. El receptor arma tramos y los encola en
+ * una cola SPSC local; un hilo aparte los acumula y los escribe con pwrite
+ * según la política, así el ciclo del receptor no espera por el disco.
+ */
+typedef struct {
+    int fd;
+    int politica;
+    long umbral;
+
+    // Cola SPSC: cabeza la avanza el receptor, fin el hilo escritor
+    tramo_t cola[COLA_TRAMOS];
+    unsigned int cabeza;
+    unsigned int fin;
+    sem_t hay_datos;
+    sem_t hay_lugar;             // Lo publica el hilo escritor si el receptor espera lugar
+    int esperando_lugar;         // 1 mientras el receptor duerme con la cola llena
+    int cerrar;
+
+    tramo_t actual;              // Tramo en construcción (solo el receptor)
+
+    // Estado del hilo escritor
+    pthread_t hilo;
+    tramo_t *pendientes;
+    int n_pendientes;
+    long bytes_pendientes;
+    struct timespec desde;       // Llegada del primer pendiente
+    unsigned char *buffer;
+    long long escrituras;        // Llamadas a pwrite realizadas
+} escritor_t;
+
+// Interpretar "bytes:<n>", "ms:<n>" o "cierre"; devuelve -1 si es inválido
+int escritor_parsear(const char *str, int *politica, long *umbral);
+
+escritor_t *escritor_crear(const char *ruta, int politica, long umbral);
+void escritor_agregar(escritor_t *e, int64_t offset, unsigned char valor);
+void escritor_enviar(escritor_t *e);
+long long escritor_cerrar(escritor_t *e);
+
+#endif
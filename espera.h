@@ -0,0 +1,168 @@
+#ifndef ESPERA_H
+#define ESPERA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Políticas de espera cuando el anillo está lleno o vacío (elegidas por proceso)
+#define ESPERA_BLOQUEO    0   // Un intento y luego dormir (semáforo o futex)
+#define ESPERA_SPIN       1   // Girar con pause sin dormir nunca
+#define ESPERA_ADAPTATIVA 2   // Girar hasta <spins> intentos y luego dormir
+
+#define SPINS_POR_DEFECTO 2000
+
+typedef struct {
+    int politica;
+    int spins;                // Intentos antes de dormir (bloqueo/adaptativa)
+} espera_t;
+
+// Formatos: "bloqueo", "spin", "adaptativa" o "adaptativa/<spins>"
+static inline int parsear_espera(const char *str, espera_t *espera) {
+    espera->spins = SPINS_POR_DEFECTO;
+
+    if (strcmp(str, "bloqueo") == 0) {
+        espera->politica = ESPERA_BLOQUEO;
+        return 0;
+    }
+    if (strcmp(str, "spin") == 0) {
+        espera->politica = ESPERA_SPIN;
+        return 0;
+    }
+    if (strncmp(str, "adaptativa", 10) == 0) {
+        espera->politica = ESPERA_ADAPTATIVA;
+        if (str[10] == '\0') {
+            return 0;
+        }
+        if (str[10] == '/') {
+            char *endptr;
+            long spins = strtol(str + 11, &endptr, 10);
+            if (*endptr == '\0' && spins > 0 && spins <= INT_MAX) {
+                espera->spins = (int)spins;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+static inline const char *nombre_espera(const espera_t *espera) {
+    switch (espera->politica) {
+    case ESPERA_SPIN:       return "spin";
+    case ESPERA_ADAPTATIVA: return "adaptativa";
+    default:                return "bloqueo";
+    }
+}
+
+// Pausa breve dentro de un ciclo de espera activa
+static inline void cpu_relax(unsigned int *spins) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+    // Ceder la CPU de vez en cuando (imprescindible con un solo núcleo)
+    if ((++*spins & 63) == 0) {
+        sched_yield();
+    }
+}
+
+/*
+ * Regla común de todas las esperas: girar siempre con spin, hasta <spins>
+ * intentos con adaptativa y nunca con bloqueo, que duerme en el primer fallo.
+ */
+static inline int seguir_girando(const espera_t *espera, unsigned int spins) {
+    return espera->politica == ESPERA_SPIN ||
+           (espera->politica == ESPERA_ADAPTATIVA && (int)spins < espera->spins);
+}
+
+/*
+ * Futex compartido entre procesos (sin FUTEX_PRIVATE_FLAG). El núcleo solo
+ * duerme al llamador si *addr sigue valiendo valor, así que no se pierden
+ * despertares entre la comprobación y la espera. Sin plazo: quien cambia
+ * cada palabra despierta su futex, la recuperación de caídos también, y el
+ * finalizador repite en cada pasada los despertares de secuencias e índices
+ * para quien revisó finalizar justo antes de que se activara.
+ */
+static inline void futex_esperar(int *addr, int valor) {
+    syscall(SYS_futex, addr, FUTEX_WAIT, valor, NULL, NULL, 0);
+}
+
+/*
+ * Dormir mientras *addr valga valor, hasta un instante absoluto de
+ * CLOCK_MONOTONIC (FUTEX_WAIT_BITSET usa ese reloj por defecto). Devuelve
+ * 0 al llegar el plazo y 1 si *addr cambió o alguien despertó el futex.
+ */
+static inline int futex_esperar_hasta(int *addr, int valor, uint64_t plazo_ns) {
+    struct timespec ts = { (time_t)(plazo_ns / 1000000000ull), (long)(plazo_ns % 1000000000ull) };
+    for (;;) {
+        if (__atomic_load_n(addr, __ATOMIC_ACQUIRE) != valor) {
+            return 1;
+        }
+        if (syscall(SYS_futex, addr, FUTEX_WAIT_BITSET, valor, &ts, NULL,
+                    FUTEX_BITSET_MATCH_ANY) == 0) {
+            return 1;
+        }
+        if (errno == ETIMEDOUT) {
+            return 0;
+        }
+    }
+}
+
+static inline void futex_despertar(int *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/*
+ * Tomar una unidad de un semáforo según la política. sem_wait de glibc ya
+ * duerme en un futex y sem_post solo hace la llamada al sistema si hay
+ * algún proceso registrado como esperando.
+ *
+ * Devuelve 0 si la tomó sin dormir, 1 si tuvo que dormir (el llamador debe
+ * revisar finalizar) y -1 si se activó finalizar o hubo un error.
+ */
+static inline int esperar_unidad(sem_t *sem, const espera_t *espera, const int *finalizar,
+                                 const char *aviso) {
+    if (sem_trywait(sem) == 0) {
+        return 0;
+    }
+    if (errno != EAGAIN) {
+        if (errno != EINTR) {
+            perror("Error en sem_trywait");
+        }
+        return -1;
+    }
+
+    unsigned int spins = 0;
+    while (seguir_girando(espera, spins)) {
+        if (sem_trywait(sem) == 0) {
+            return 0;
+        }
+        if (__atomic_load_n(finalizar, __ATOMIC_RELAXED)) {
+            return -1;
+        }
+        cpu_relax(&spins);
+    }
+
+    // El llamador ya se marcó como esperando: si finalizar aún no está
+    // activo, el finalizador verá la marca y publicará una unidad para despertarlo
+    if (__atomic_load_n(finalizar, __ATOMIC_SEQ_CST)) {
+        return -1;
+    }
+    if (aviso) {
+        printf("%s", aviso);
+    }
+    if (sem_wait(sem) == -1) {
+        return -1;
+    }
+    return 1;
+}
+
+#endif
@@ -10,54 +10,213 @@
 #include <time.h>
 #include <errno.h>
 #include "memoria_compartida.h"
+#include "recuperacion.h"
+#include "registros.h"
 
-// Variable global para manejar la señal
-volatile sig_atomic_t signal_received = 0;
-shared_mem_t *global_shm = NULL;
-size_t global_shm_size = 0;
+#define ESPERA_PROCESOS_NS 10000000000ull  // Máximo 10 segundos esperando a que salgan
 
-void signal_handler(int signum) {
-    printf("\n" COLOR_YELLOW "Señal recibida (%d). Iniciando finalización...\n" COLOR_RESET, signum);
-    signal_received = 1;
-}
+/*
+ * Plazo de cada pasada mientras se espera la salida. Los procesos duermen en
+ * sus futex sin plazo, y quien revisó finalizar justo antes de activarse y
+ * se durmió en una secuencia o un índice de registros después del despertar
+ * de despertar_procesos solo sale con el de la pasada siguiente. Las pasadas
+ * también recuperan a los caídos, que nunca descuentan su contador.
+ */
+#define REPASO_CIERRE_NS 10000000ull
 
 void print_separator(void) {
     printf(COLOR_CYAN "========================================" COLOR_RESET "\n");
 }
 
+void print_latencias(const char *nombre, const histograma_t *histogramas) {
+    histograma_t total;
+    hist_sumar(&total, histogramas, MAX_HISTOGRAMAS);
+
+    if (total.total == 0) {
+        printf("%s: " COLOR_YELLOW "sin muestras\n" COLOR_RESET, nombre);
+        return;
+    }
+    printf("%s: " COLOR_YELLOW "p50 %.1f us, p99 %.1f us, p99.9 %.1f us, "
+           "media %.1f us, máx %.1f us\n" COLOR_RESET, nombre,
+           hist_percentil(&total, 0.50) / 1000.0,
+           hist_percentil(&total, 0.99) / 1000.0,
+           hist_percentil(&total, 0.999) / 1000.0,
+           (double)total.suma_ns / total.total / 1000.0,
+           total.max_ns / 1000.0);
+}
+
+// Leer los contadores de trabajadores activos, un hilo de trabajo cuenta como uno (bajo el mutex en modo mutex)
+void contar_activos(shared_mem_t *shm, int *emisores, int *receptores) {
+    if (shm->modo_anillo == MODO_ANILLO_MUTEX) {
+        bloquear(&shm->mutex);
+    }
+    *emisores = __atomic_load_n(&shm->emisores_activos, __ATOMIC_ACQUIRE);
+    *receptores = __atomic_load_n(&shm->receptores_activos, __ATOMIC_ACQUIRE);
+    if (shm->modo_anillo == MODO_ANILLO_MUTEX) {
+        pthread_mutex_unlock(&shm->mutex);
+    }
+}
+
+/*
+ * Despertar a quien duerma en el futex de una secuencia (slots lock-free y
+ * de difusión, sellos de registros) o en un índice del carril de registros.
+ * Cada dormido en una secuencia anotó en su registro cuál espera; con
+ * registros de desborde compartidos esa anotación puede pisarse, así que
+ * entonces se recorren todas las secuencias del anillo. Devuelve cuántos
+ * quedaban dormidos antes de la pasada.
+ */
+int despertar_secuencias(shared_mem_t *shm) {
+    int dormidos = __atomic_load_n(&shm->esperando_slot, __ATOMIC_SEQ_CST);
+    if (dormidos <= 0) {
+        return 0;
+    }
+
+    int n = procesos_registrados(shm);
+    for (int i = 0; i < n; i++) {
+        int64_t offset = __atomic_load_n(&shm->procesos[i].dormido_en, __ATOMIC_SEQ_CST);
+        if (offset != 0) {
+            futex_despertar((int *)(void *)((char *)shm + offset));
+        }
+    }
+    if (shm->modo_anillo == MODO_ANILLO_REGISTROS) {
+        futex_despertar(&shm->carriles[0].liberado);
+        futex_despertar(&shm->carriles[0].write_index);
+    }
+    if (__atomic_load_n(&shm->n_procesos, __ATOMIC_SEQ_CST) <= MAX_REGISTROS) {
+        return dormidos;
+    }
+    if (shm->modo_anillo == MODO_ANILLO_REGISTROS) {
+        for (int t = 0; t < shm->carril_size; t += REGISTRO_ALINEACION) {
+            futex_despertar(&cabecera_registro(shm, t)->sello);
+        }
+    } else if (shm->modo_anillo != MODO_ANILLO_MUTEX) {
+        for (int pos = 0; pos < shm->buffer_size; pos++) {
+            futex_despertar(secuencia_slot(shm, pos));
+        }
+    }
+    return dormidos;
+}
+
+/*
+ * Activar finalizar y despertar a todos los que esperan. Las pausas de los
+ * modos automáticos duermen en el futex de finalizar, el modo manual en
+ * epoca_cierre y los receptores con varios carriles en aviso_datos; a los
+ * que duermen en un semáforo se les publica exactamente una unidad, guiada
+ * por su marca de espera, y a los que esperan una secuencia se los despierta
+ * en la que anotaron. Marcas y finalizar se escriben y leen en orden
+ * secuencialmente consistente, así que un proceso que empieza a esperar
+ * después de esta pasada ya ve finalizar y no duerme.
+ */
+int despertar_procesos(shared_mem_t *shm) {
+    if (shm->modo_anillo == MODO_ANILLO_MUTEX) {
+        bloquear(&shm->mutex);
+    }
+    __atomic_store_n(&shm->finalizar, 1, __ATOMIC_SEQ_CST);
+    if (shm->modo_anillo == MODO_ANILLO_MUTEX) {
+        pthread_mutex_unlock(&shm->mutex);
+    }
+    futex_despertar(&shm->finalizar);
+    __atomic_fetch_add(&shm->epoca_cierre, 1, __ATOMIC_SEQ_CST);
+    futex_despertar(&shm->epoca_cierre);
+    avisar_receptores(shm);
+    despertar_secuencias(shm);
+    if (shm->modo_anillo == MODO_ANILLO_DIFUSION) {
+        // Los emisores frenados duermen en avance_cursores y los receptores
+        // en la secuencia de su slot: ninguno usa los semáforos
+        __atomic_fetch_add(&shm->avance_cursores, 1, __ATOMIC_SEQ_CST);
+        futex_despertar(&shm->avance_cursores);
+        return 0;
+    }
+    if (shm->modo_anillo == MODO_ANILLO_REGISTROS) {
+        return 0;  // despertar_secuencias ya despertó liberado y write_index
+    }
+
+    int despertados = 0;
+    if (__atomic_load_n(&shm->n_procesos, __ATOMIC_SEQ_CST) > MAX_REGISTROS) {
+        // Hay procesos compartiendo registros de desborde: no se sabe quién
+        // espera, así que se publica una unidad por proceso en cada carril
+        int emisores, receptores;
+        contar_activos(shm, &emisores, &receptores);
+        for (int c = 0; c < shm->n_carriles; c++) {
+            publicar(&shm->carriles[c].espacios_libres, emisores);
+            publicar(&shm->carriles[c].espacios_ocupados, receptores);
+        }
+        return emisores + receptores;
+    }
+
+    int n = procesos_registrados(shm);
+    for (int i = 0; i < n; i++) {
+        proceso_t *p = &shm->procesos[i];
+        if (!__atomic_load_n(&p->esperando, __ATOMIC_SEQ_CST)) {
+            continue;
+        }
+        if (p->tipo == PROCESO_EMISOR) {
+            sem_post(&shm->carriles[p->carril].espacios_libres);
+            despertados++;
+        } else if (shm->n_carriles == 1) {
+            sem_post(&shm->carriles[0].espacios_ocupados);
+            despertados++;
+        }
+    }
+    return despertados;
+}
+
 void print_statistics(shared_mem_t *shm) {
     print_separator();
     printf(COLOR_BOLD COLOR_CYAN "    ESTADÍSTICAS FINALES\n" COLOR_RESET);
     print_separator();
     
     printf("\n" COLOR_GREEN "Transferencia de datos:\n" COLOR_RESET);
-    printf("Total de caracteres transferidos: " COLOR_YELLOW "%d\n" COLOR_RESET, 
-           shm->chars_transferidos);
+    printf("Total de caracteres transferidos: " COLOR_YELLOW "%llu\n" COLOR_RESET, 
+           (unsigned long long)total_procesos(shm, PROCESO_EMISOR));
+    printf("Total de caracteres recibidos: " COLOR_YELLOW "%llu\n" COLOR_RESET, 
+           (unsigned long long)total_procesos(shm, PROCESO_RECEPTOR));
     
     // Calcular caracteres en memoria (diferencia entre escritos y leídos)
-    int chars_en_memoria = shm->write_index - shm->read_index;
+    int chars_en_memoria = chars_en_anillo(shm);
     if (chars_en_memoria < 0) chars_en_memoria = 0;
     
     printf("Caracteres en memoria compartida: " COLOR_YELLOW "%d\n" COLOR_RESET, 
            chars_en_memoria);
     printf("Tamaño del buffer: " COLOR_YELLOW "%d\n" COLOR_RESET, 
            shm->buffer_size);
+    printf("Carriles: " COLOR_YELLOW "%d de %d slots\n" COLOR_RESET, 
+           shm->n_carriles, shm->carril_size);
+    printf("Modo de anillo: " COLOR_YELLOW "%s\n" COLOR_RESET, 
+           nombre_anillo(shm->modo_anillo));
     
-    printf("\n" COLOR_GREEN "Procesos:\n" COLOR_RESET);
+    printf("\n" COLOR_GREEN "Latencias (medidas por los receptores):\n" COLOR_RESET);
+    print_latencias("Extremo a extremo", shm->extremo);
+    print_latencias("Residencia en cola", shm->residencia);
+    
+    // Los contadores de activos y de caídos cuentan trabajadores: cada hilo de un proceso es uno
+    printf("\n" COLOR_GREEN "Trabajadores (procesos e hilos):\n" COLOR_RESET);
     printf("Emisores activos: " COLOR_YELLOW "%d\n" COLOR_RESET, 
            shm->emisores_activos);
     printf("Receptores activos: " COLOR_YELLOW "%d\n" COLOR_RESET, 
            shm->receptores_activos);
+    printf("Trabajadores caídos recuperados: " COLOR_YELLOW "%d (slots saltados: %d)\n" COLOR_RESET, 
+           shm->procesos_caidos, shm->slots_saltados);
     
     printf("\n" COLOR_GREEN "Uso de memoria:\n" COLOR_RESET);
-    size_t memoria_utilizada = sizeof(shared_mem_t) + 
-                               (shm->buffer_size * sizeof(char_info_t));
+    size_t memoria_utilizada = calcular_shm_size(shm);
+    size_t memoria_buffer = memoria_utilizada - sizeof(shared_mem_t);
     printf("Memoria total utilizada: " COLOR_YELLOW "%zu bytes\n" COLOR_RESET, 
            memoria_utilizada);
     printf(" Memoria de control: " COLOR_YELLOW "%zu bytes\n" COLOR_RESET, 
            sizeof(shared_mem_t));
     printf("Memoria del buffer: " COLOR_YELLOW "%zu bytes\n" COLOR_RESET, 
-           shm->buffer_size * sizeof(char_info_t));
+           memoria_buffer);
+    printf("Layout de slots: " COLOR_YELLOW "%s (%.3f bytes por slot)\n" COLOR_RESET, 
+           shm->layout == LAYOUT_SOA ? "soa" : "aos",
+           (double)memoria_buffer / shm->buffer_size);
+    printf("Formato del segmento: " COLOR_YELLOW "versión %u, características 0x%02x\n" COLOR_RESET,
+           shm->cabecera.version, shm->cabecera.caracteristicas);
+    printf("Segmento: " COLOR_YELLOW "%s%s%s%s\n" COLOR_RESET,
+           (shm->opciones_segmento & SEGMENTO_HUGETLB) ? "hugetlbfs" : "/dev/shm",
+           (shm->opciones_segmento & SEGMENTO_THP) ? " + thp" : "",
+           (shm->opciones_segmento & SEGMENTO_POPULATE) ? " + populate" : "",
+           (shm->opciones_segmento & SEGMENTO_MLOCK) ? " + mlock" : "");
     printf("Archivo fuente: " COLOR_YELLOW "%s\n" COLOR_RESET, 
            shm->filename);
     print_separator();
@@ -77,108 +236,76 @@ int main(int argc, char *argv[]) {
     printf("\n" COLOR_YELLOW "Presione Ctrl+C para finalizar todos los procesos.\n" COLOR_RESET);
     print_separator();
 
-    // Configurar manejadores de señales
-    signal(SIGINT, signal_handler);   // Ctrl+C
-    signal(SIGTERM, signal_handler);  // kill
-    signal(SIGUSR1, signal_handler);  // Señal personalizada
-
-    // Abrir memoria compartida
-    int shm_fd = shm_open(shm_name, O_RDWR, 0666);
-    if (shm_fd == -1) {
-        perror("Error: No se puede abrir la memoria compartida");
-        fprintf(stderr, "Ejecutar inicializador primero\n");
-        return 1;
-    }
-    size_t base_size = sizeof(shared_mem_t);
-    shared_mem_t *shm_temp = mmap(NULL, base_size, PROT_READ | PROT_WRITE, 
-                                   MAP_SHARED, shm_fd, 0);
-
-    if (shm_temp == MAP_FAILED) {
-        perror("Error al mapear memoria compartida");
-        close(shm_fd);
-        return 1;
-    }
+    // Las señales de finalización se bloquean y se reciben con sigwaitinfo
+    sigset_t senales;
+    sigemptyset(&senales);
+    sigaddset(&senales, SIGINT);   // Ctrl+C
+    sigaddset(&senales, SIGTERM);  // kill
+    sigaddset(&senales, SIGUSR1);  // Señal personalizada
+    sigprocmask(SIG_BLOCK, &senales, NULL);
 
-    // Leer el buffer_size
-    int buffer_size = shm_temp->buffer_size;
-
-    munmap(shm_temp, base_size);
-
-    // Inicializar de nuevo con tamano correcto
-    size_t shm_size = sizeof(shared_mem_t) + (buffer_size * sizeof(char_info_t));
-    shared_mem_t *shm = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, 
-                             MAP_SHARED, shm_fd, 0);
-    
-    if (shm == MAP_FAILED) {
-        perror("Error al mapear memoria compartida");
-        close(shm_fd);
+    // Conectarse como observador: el supervisor no ocupa registro ni carril
+    canal_t *canal = canal_abrir(shm_name, CANAL_OBSERVADOR, NULL);
+    if (!canal) {
         return 1;
     }
-
-    global_shm = shm;
-    global_shm_size = shm_size;
+    shared_mem_t *shm = canal_segmento(canal);
+    int buffer_size = shm->buffer_size;
 
     printf(COLOR_GREEN "Conectado a la memoria compartida\n" COLOR_RESET);
     printf("Buffer size: %d bytes\n", buffer_size);
     printf("\n" COLOR_CYAN "Esperando señal de finalización...\n" COLOR_RESET);
 
-    while (!signal_received) {
-        sleep(1);
+    // Mientras espera la señal, supervisa: recupera a los procesos que mueren sin salir
+    siginfo_t info;
+    struct timespec periodo = { 0, PERIODO_RECUPERACION_MS * 1000000L };
+    while (sigtimedwait(&senales, &info, &periodo) == -1) {
+        int recuperados = recuperar_caidos(shm);
+        if (recuperados > 0) {
+            printf(COLOR_MAGENTA "Trabajadores caídos recuperados: %d (total %d, slots saltados %d)\n"
+                   COLOR_RESET, recuperados, shm->procesos_caidos, shm->slots_saltados);
+            fflush(stdout);
+        }
     }
+    printf("\n" COLOR_YELLOW "Señal recibida (%d). Iniciando finalización...\n" COLOR_RESET,
+           info.si_signo);
 
     printf("\n" COLOR_RED "Iniciando secuencia de finalización...\n" COLOR_RESET);
+    uint64_t inicio = reloj_ns();
 
-    //Activar flag de finalización
-    sem_wait(&shm->mutex);
-    shm->finalizar = 1;
-    int emisores_activos = shm->emisores_activos;
-    int receptores_activos = shm->receptores_activos;
-    sem_post(&shm->mutex);
+    int emisores_activos, receptores_activos;
+    contar_activos(shm, &emisores_activos, &receptores_activos);
+    int despertados = despertar_procesos(shm);
 
     printf(COLOR_YELLOW "Flag de finalización activado\n" COLOR_RESET);
-    printf("Emisores activos detectados: %d\n", emisores_activos);
-    printf("Receptores activos detectados: %d\n", receptores_activos);
-    printf(COLOR_YELLOW "\nDespertando receptores bloqueados...\n" COLOR_RESET);
-    for (int i = 0; i < receptores_activos + 5; i++) {
-        sem_post(&shm->espacios_ocupados);
-    }
-
-    // Los emisores pueden estar esperando en sem_wait(&espacios_libres)
-    printf(COLOR_YELLOW "Despertando emisores bloqueados...\n" COLOR_RESET);
-    for (int i = 0; i < emisores_activos + 5; i++) {
-        sem_post(&shm->espacios_libres);
-    }
+    printf("Emisores activos detectados (trabajadores): %d\n", emisores_activos);
+    printf("Receptores activos detectados (trabajadores): %d\n", receptores_activos);
+    printf("Trabajadores despertados en semáforos: %d\n", despertados);
     printf(COLOR_YELLOW "\n Esperando a que los procesos terminen...\n" COLOR_RESET);
-    
-    int timeout = 10;  // Máximo 10 segundos de espera
-    int elapsed = 0;
-    
-    while (elapsed < timeout) {
-        sem_wait(&shm->mutex);
-        int emisores = shm->emisores_activos;
-        int receptores = shm->receptores_activos;
-        sem_post(&shm->mutex);
-        
-        if (emisores == 0 && receptores == 0) {
-            printf(COLOR_GREEN "Todos los procesos han finalizado\n" COLOR_RESET);
+
+    // Cada proceso despierta el futex de su contador al salir
+    int emisores_final, receptores_final;
+    for (;;) {
+        contar_activos(shm, &emisores_final, &receptores_final);
+        if (emisores_final == 0 && receptores_final == 0) {
+            printf(COLOR_GREEN "Todos los procesos han finalizado en %.2f ms\n" COLOR_RESET,
+                   (reloj_ns() - inicio) / 1e6);
+            break;
+        }
+        if (reloj_ns() - inicio > ESPERA_PROCESOS_NS) {
             break;
         }
-        
-        printf("[%d/%d] Emisores: %d, Receptores: %d\r", 
-               elapsed + 1, timeout, emisores, receptores);
-        fflush(stdout);
-        
-        sleep(1);
-        elapsed++;
+        recuperar_caidos(shm);  // Quien murió no descontará su contador
+        despertar_secuencias(shm);  // Quien se durmió justo al pasar despertar_procesos
+        uint64_t plazo = reloj_ns() + REPASO_CIERRE_NS;
+        if (emisores_final > 0) {
+            futex_esperar_hasta(&shm->emisores_activos, emisores_final, plazo);
+        } else {
+            futex_esperar_hasta(&shm->receptores_activos, receptores_final, plazo);
+        }
     }
     printf("\n");
 
-    // Verificación final
-    sem_wait(&shm->mutex);
-    int emisores_final = shm->emisores_activos;
-    int receptores_final = shm->receptores_activos;
-    sem_post(&shm->mutex);
-
     if (emisores_final > 0 || receptores_final > 0) {
         printf("Emisores restantes: %d\n", emisores_final);
         printf("Receptores restantes: %d\n", receptores_final);
@@ -187,19 +314,9 @@ int main(int argc, char *argv[]) {
     printf("\n");
     print_statistics(shm);
 
-    // Destruir semáforos
-    sem_destroy(&shm->espacios_libres);
-    sem_destroy(&shm->espacios_ocupados);
-    sem_destroy(&shm->mutex);
-    printf("Semáforos destruidos\n");
-
-    // Desmapear memoria
-    munmap(shm, shm_size);
-    close(shm_fd);
-    printf("Memoria desmapeada\n");
-
-    // Eliminar el objeto de memoria compartida
-    if (shm_unlink(shm_name) == 0) {
+    // Destruir semáforos y mutex, desmapear y eliminar el segmento
+    if (canal_destruir(canal) == 0) {
+        printf("Semáforos destruidos\n");
         printf("Memoria compartida eliminada\n");
     } else {
         perror("No se elimino la memoria");
@@ -0,0 +1,118 @@
+#ifndef HILOS_H
+#define HILOS_H
+
+/*
+ * Hilos de trabajo de un emisor o receptor: --threads=N corre N ciclos
+ * contra el mismo anillo dentro de un proceso (un mapeo, un archivo y una
+ * consola para todos) y --cpus=<lista> fija el hilo i a la i-ésima CPU de
+ * la lista, en ronda. pthread_setaffinity_np pide _GNU_SOURCE antes del
+ * primer include de quien use este archivo.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_HILOS 64
+
+typedef struct {
+    int n;                    // Hilos de trabajo (1 = solo el principal)
+    int cpus[MAX_HILOS];
+    int n_cpus;               // 0 = sin afinidad
+} hilos_t;
+
+static inline void hilos_defecto(hilos_t *h) {
+    h->n = 1;
+    h->n_cpus = 0;
+}
+
+// Lista de CPUs con rangos: "0,2,4-7"
+static inline int parsear_cpus(const char *str, hilos_t *h) {
+    h->n_cpus = 0;
+    while (*str) {
+        char *endptr;
+        long desde = strtol(str, &endptr, 10);
+        long hasta = desde;
+        if (endptr == str) {
+            return -1;
+        }
+        if (*endptr == '-') {
+            str = endptr + 1;
+            hasta = strtol(str, &endptr, 10);
+            if (endptr == str) {
+                return -1;
+            }
+        }
+        if (desde < 0 || hasta < desde || hasta >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (long cpu = desde; cpu <= hasta; cpu++) {
+            if (h->n_cpus == MAX_HILOS) {
+                return -1;
+            }
+            h->cpus[h->n_cpus++] = (int)cpu;
+        }
+        if (*endptr == ',') {
+            endptr++;
+        } else if (*endptr != '\0') {
+            return -1;
+        }
+        str = endptr;
+    }
+    return h->n_cpus > 0 ? 0 : -1;
+}
+
+// Interpretar --threads=<n> o --cpus=<lista>; devuelve 0 si la tomó y -1 si no
+static inline int parsear_opcion_hilos(const char *arg, hilos_t *h) {
+    if (strncmp(arg, "--threads=", 10) == 0) {
+        char *endptr;
+        long n = strtol(arg + 10, &endptr, 10);
+        if (*endptr != '\0' || n < 1 || n > MAX_HILOS) {
+            fprintf(stderr, "Error: Los hilos deben estar entre 1 y %d\n", MAX_HILOS);
+            return -1;
+        }
+        h->n = (int)n;
+        return 0;
+    }
+    if (strncmp(arg, "--cpus=", 7) == 0) {
+        if (parsear_cpus(arg + 7, h) < 0) {
+            fprintf(stderr, "Error: Lista de CPUs inválida. Use por ejemplo '0,2,4-7'\n");
+            return -1;
+        }
+        return 0;
+    }
+    fprintf(stderr, "Error: Opción inválida '%s'\n", arg);
+    return -1;
+}
+
+static inline void hilos_describir(const hilos_t *h, char *buf, size_t len) {
+    int usado = snprintf(buf, len, "%d", h->n);
+    if (h->n_cpus > 0 && usado > 0 && (size_t)usado < len) {
+        usado += snprintf(buf + usado, len - usado, " (CPUs");
+        for (int i = 0; i < h->n_cpus && (size_t)usado < len; i++) {
+            usado += snprintf(buf + usado, len - usado, "%s%d", i ? "," : " ", h->cpus[i]);
+        }
+        if ((size_t)usado < len) {
+            snprintf(buf + usado, len - usado, ")");
+        }
+    }
+}
+
+// Fijar el hilo que llama a la CPU que le toca (sin --cpus no hace nada)
+static inline void fijar_afinidad(const hilos_t *h, int indice) {
+    if (h->n_cpus == 0) {
+        return;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(h->cpus[indice % h->n_cpus], &cpus);
+    int r = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (r != 0) {
+        errno = r;
+        perror("Aviso: No se pudo fijar la afinidad del hilo");
+    }
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef HISTOGRAMA_H
+#define HISTOGRAMA_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Histograma logarítmico de latencias en nanosegundos. Cada potencia de dos
+ * se divide en HIST_SUBCUBETAS cubetas, con un error relativo de a lo sumo
+ * 25%. Los contadores se actualizan con sumas atómicas relajadas, así que
+ * varios procesos pueden registrar a la vez sin bloquearse; aun así cada
+ * receptor usa su propio histograma para no compartir líneas de caché.
+ */
+#define HIST_BITS_SUB     2
+#define HIST_SUBCUBETAS   (1 << HIST_BITS_SUB)
+#define HIST_EXPONENTES   44                      // Hasta 2^44 ns, ~4.9 horas
+#define HIST_CUBETAS      (HIST_EXPONENTES * HIST_SUBCUBETAS)
+
+typedef struct {
+    uint64_t total;
+    uint64_t suma_ns;
+    uint64_t max_ns;
+    uint64_t cubetas[HIST_CUBETAS];
+} __attribute__((aligned(64))) histograma_t;  // Sin líneas compartidas entre procesos
+
+static inline uint64_t reloj_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline int hist_cubeta(uint64_t ns) {
+    if (ns < HIST_SUBCUBETAS) {
+        return (int)ns;
+    }
+    int exp = 63 - __builtin_clzll(ns);
+    int sub = (int)(ns >> (exp - HIST_BITS_SUB)) & (HIST_SUBCUBETAS - 1);
+    int cubeta = (exp - HIST_BITS_SUB + 1) * HIST_SUBCUBETAS + sub;
+    return cubeta < HIST_CUBETAS ? cubeta : HIST_CUBETAS - 1;
+}
+
+// Límite superior (en ns) de los valores que caen en una cubeta
+static inline uint64_t hist_limite(int cubeta) {
+    if (cubeta < HIST_SUBCUBETAS) {
+        return (uint64_t)cubeta;
+    }
+    int exp = cubeta / HIST_SUBCUBETAS + HIST_BITS_SUB - 1;
+    int sub = cubeta % HIST_SUBCUBETAS;
+    return ((uint64_t)(HIST_SUBCUBETAS + sub + 1) << (exp - HIST_BITS_SUB)) - 1;
+}
+
+// Registrar n muestras que caen en la misma cubeta, con suma y máximo ya
+// calculados: una suma atómica por contador en vez de una por muestra
+static inline void hist_registrar_cubeta(histograma_t *h, int cubeta, uint64_t n, uint64_t suma_ns,
+                                         uint64_t max_ns) {
+    __atomic_fetch_add(&h->cubetas[cubeta], n, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, n, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->suma_ns, suma_ns, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (max_ns > max &&
+           !__atomic_compare_exchange_n(&h->max_ns, &max, max_ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static inline void hist_registrar(histograma_t *h, uint64_t ns) {
+    hist_registrar_cubeta(h, hist_cubeta(ns), 1, ns, ns);
+}
+
+// Acumular n histogramas (uno por proceso) en uno solo
+static inline void hist_sumar(histograma_t *destino, const histograma_t *origen, int n) {
+    memset(destino, 0, sizeof(*destino));
+    for (int i = 0; i < n; i++) {
+        destino->total += __atomic_load_n(&origen[i].total, __ATOMIC_RELAXED);
+        destino->suma_ns += __atomic_load_n(&origen[i].suma_ns, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&origen[i].max_ns, __ATOMIC_RELAXED);
+        if (max > destino->max_ns) {
+            destino->max_ns = max;
+        }
+        for (int c = 0; c < HIST_CUBETAS; c++) {
+            destino->cubetas[c] += __atomic_load_n(&origen[i].cubetas[c], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Percentil p (0..1) en ns; devuelve el límite superior de la cubeta
+static inline uint64_t hist_percentil(const histograma_t *h, double p) {
+    if (h->total == 0) {
+        return 0;
+    }
+    uint64_t objetivo = (uint64_t)(p * (double)h->total);
+    if (objetivo >= h->total) {
+        objetivo = h->total - 1;
+    }
+
+    uint64_t acumulado = 0;
+    for (int c = 0; c < HIST_CUBETAS; c++) {
+        acumulado += h->cubetas[c];
+        if (acumulado > objetivo) {
+            uint64_t limite = hist_limite(c);
+            return limite < h->max_ns ? limite : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+#endif
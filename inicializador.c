@@ -2,16 +2,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
-#include <semaphore.h>
 #include <errno.h>
+#include "canal.h"
 #include "memoria_compartida.h"
 
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        fprintf(stderr, "Uso: %s <identificador_shm> <tamaño_buffer> <archivo_fuente>\n", argv[0]);
-        fprintf(stderr, "Ejemplo: %s /mi_memoria 10 input.txt\n", argv[0]);
+    if (argc < 4) {
+        fprintf(stderr, "Uso: %s <identificador_shm> <tamaño_buffer> <archivo_fuente> [opciones...]\n", argv[0]);
+        fprintf(stderr, "Opciones:\n");
+        fprintf(stderr, "  mutex     - Índices protegidos por un semáforo global (por defecto)\n");
+        fprintf(stderr, "  lockfree  - Secuencia por slot y fetch-add atómico\n");
+        fprintf(stderr, "  difusion  - Cada receptor recibe todo con su propio cursor (un carril)\n");
+        fprintf(stderr, "  registros - Líneas como registros de largo variable (un carril, tamaño en bytes)\n");
+        fprintf(stderr, "  aos       - Slots char_info_t completos (por defecto)\n");
+        fprintf(stderr, "  soa       - Slots compactos: valores densos y marcas por bloque\n");
+        fprintf(stderr, "  carriles=<k> - Dividir el buffer en k sub-anillos (por defecto 1, máx. %d)\n",
+                MAX_CARRILES);
+        fprintf(stderr, "  huge      - Segmento en hugetlbfs (%s o $CANAL_HUGETLBFS)\n", DIR_HUGETLBFS);
+        fprintf(stderr, "  thp       - Pedir páginas grandes transparentes para /dev/shm\n");
+        fprintf(stderr, "  populate  - Prefaltar el segmento al conectarse cada proceso\n");
+        fprintf(stderr, "  mlock     - Bloquear el segmento en RAM en cada proceso\n");
+        fprintf(stderr, "  numa=<n>  - Ligar la memoria del segmento al nodo NUMA n\n");
+        fprintf(stderr, "El tamaño del buffer y los carriles se redondean a potencias de dos.\n");
+        fprintf(stderr, "Ejemplo: %s /mi_memoria 1024 input.txt lockfree soa carriles=4\n", argv[0]);
         return 1;
     }
 
@@ -20,13 +36,55 @@ int main(int argc, char *argv[]) {
     // Validar y convertir el tamaño del buffer
     char *endptr;
     long buffer_size = strtol(argv[2], &endptr, 10);
-    if (*endptr != '\0' || buffer_size <= 0) {
-        fprintf(stderr, "Error: El tamaño del buffer debe ser un entero positivo\n");
+    if (*endptr != '\0' || buffer_size <= 0 || buffer_size > BUFFER_MAX) {
+        fprintf(stderr, "Error: El tamaño del buffer debe ser un entero positivo (máx. 2^30)\n");
         return 1;
     }
 
     const char *filename = argv[3];
-    
+
+    canal_config_t cfg;
+    canal_config_defecto(&cfg);
+    cfg.capacidad = buffer_size;
+    for (int i = 4; i < argc; i++) {
+        if (strcmp(argv[i], "lockfree") == 0) {
+            cfg.modo_anillo = MODO_ANILLO_LOCKFREE;
+        } else if (strcmp(argv[i], "difusion") == 0) {
+            cfg.modo_anillo = MODO_ANILLO_DIFUSION;
+        } else if (strcmp(argv[i], "registros") == 0) {
+            cfg.modo_anillo = MODO_ANILLO_REGISTROS;
+        } else if (strcmp(argv[i], "mutex") == 0) {
+            cfg.modo_anillo = MODO_ANILLO_MUTEX;
+        } else if (strcmp(argv[i], "soa") == 0) {
+            cfg.layout = LAYOUT_SOA;
+        } else if (strcmp(argv[i], "aos") == 0) {
+            cfg.layout = LAYOUT_AOS;
+        } else if (strncmp(argv[i], "carriles=", 9) == 0) {
+            cfg.carriles = strtol(argv[i] + 9, &endptr, 10);
+            if (*endptr != '\0' || cfg.carriles <= 0 || cfg.carriles > MAX_CARRILES) {
+                fprintf(stderr, "Error: Los carriles deben estar entre 1 y %d\n", MAX_CARRILES);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "huge") == 0) {
+            cfg.opciones_segmento |= SEGMENTO_HUGETLB;
+        } else if (strcmp(argv[i], "thp") == 0) {
+            cfg.opciones_segmento |= SEGMENTO_THP;
+        } else if (strcmp(argv[i], "populate") == 0) {
+            cfg.opciones_segmento |= SEGMENTO_POPULATE;
+        } else if (strcmp(argv[i], "mlock") == 0) {
+            cfg.opciones_segmento |= SEGMENTO_MLOCK;
+        } else if (strncmp(argv[i], "numa=", 5) == 0) {
+            cfg.nodo_numa = strtol(argv[i] + 5, &endptr, 10);
+            if (*endptr != '\0' || cfg.nodo_numa < 0 || cfg.nodo_numa >= 64) {
+                fprintf(stderr, "Error: El nodo NUMA debe estar entre 0 y 63\n");
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Error: Opción inválida '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+
     // Verificar que el archivo existe
     FILE *test_file = fopen(filename, "r");
     if (!test_file) {
@@ -34,104 +92,78 @@ int main(int argc, char *argv[]) {
                 filename, strerror(errno));
         return 1;
     }
-    fclose(test_file);
-
-    // Calcular tamaño total de la memoria compartida
-    size_t shm_size = sizeof(shared_mem_t) + (buffer_size * sizeof(char_info_t));
-    
-    printf("=== Inicializador de Memoria Compartida ===\n");
-    printf("Identificador: %s\n", shm_name);
-    printf("Tamaño del buffer: %ld caracteres\n", buffer_size);
-    printf("Archivo fuente: %s\n", filename);
-    printf("Tamaño total de memoria: %zu bytes\n", shm_size);
-    printf("\n");
-
-    // Eliminar memoria compartida previa si existe
-    shm_unlink(shm_name);
-
-    // Crear memoria compartida
-    int shm_fd = shm_open(shm_name, O_CREAT | O_RDWR | O_EXCL, 0666);
-    if (shm_fd == -1) {
-        perror("Error al crear memoria compartida");
+    struct stat fuente_st;
+    if (fstat(fileno(test_file), &fuente_st) == -1) {
+        perror("Error al obtener el tamaño del archivo fuente");
+        fclose(test_file);
         return 1;
     }
+    fclose(test_file);
+    int64_t file_size = fuente_st.st_size;
 
-    // Establecer el tamaño de archivo
-    if (ftruncate(shm_fd, shm_size) == -1) {
-        perror("Error al establecer tamaño de memoria compartida");
-        close(shm_fd);
-        shm_unlink(shm_name);
+    cfg.fuente = filename;
+    cfg.tamano_fuente = file_size;
+    cfg.salida = ARCHIVO_SALIDA;
+    canal_t *canal = canal_crear(shm_name, &cfg);
+    if (!canal) {
         return 1;
     }
 
-    // Mapear la memoria compartida
-    shared_mem_t *shm = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    
-    if (shm == MAP_FAILED) {
-        perror("Error al mapear memoria compartida");
-        close(shm_fd);
-        shm_unlink(shm_name);
+    // Preasignar la salida: los receptores escriben cada byte en su offset
+    int output_fd = open(ARCHIVO_SALIDA, O_CREAT | O_RDWR | O_TRUNC, 0666);
+    if (output_fd == -1 || ftruncate(output_fd, file_size) == -1) {
+        fprintf(stderr, "Error: No se puede preparar el archivo de salida '%s': %s\n",
+                ARCHIVO_SALIDA, strerror(errno));
+        if (output_fd != -1) {
+            close(output_fd);
+        }
+        canal_destruir(canal);
         return 1;
     }
-
-    // Inicializar todos los campos a cero
-    memset(shm, 0, shm_size);
-
-    // Inicializar semáforos
-    if (sem_init(&shm->espacios_libres, 1, buffer_size) == -1) {
-        perror("Error al inicializar espacios_libres");
-        munmap(shm, shm_size);
-        close(shm_fd);
-        shm_unlink(shm_name);
-        return 1;
+    if (file_size > 0) {
+        posix_fallocate(output_fd, 0, file_size);  // Reservar bloques si el FS lo permite
     }
+    close(output_fd);
 
-    if (sem_init(&shm->espacios_ocupados, 1, 0) == -1) {
-        perror("Error al inicializar espacios_ocupados");
-        sem_destroy(&shm->espacios_libres);
-        munmap(shm, shm_size);
-        close(shm_fd);
-        shm_unlink(shm_name);
-        return 1;
-    }
+    canal_info_t info;
+    canal_info(canal, &info);
+    canal_cerrar(canal);
 
-    if (sem_init(&shm->mutex, 1, 1) == -1) {
-        perror("Error al inicializar mutex");
-        sem_destroy(&shm->espacios_libres);
-        sem_destroy(&shm->espacios_ocupados);
-        munmap(shm, shm_size);
-        close(shm_fd);
-        shm_unlink(shm_name);
-        return 1;
+    printf("=== Inicializador de Memoria Compartida ===\n");
+    printf("Identificador: %s\n", shm_name);
+    if (info.capacidad != buffer_size) {
+        printf("Tamaño del buffer: %d caracteres (ajustado desde %ld)\n", info.capacidad, buffer_size);
+    } else {
+        printf("Tamaño del buffer: %d caracteres\n", info.capacidad);
     }
-
-    if (sem_init(&shm->file_mutex, 1, 1) == -1) {
-        perror("Error al inicializar file_mutex");
-        sem_destroy(&shm->espacios_libres);
-        sem_destroy(&shm->espacios_ocupados);
-        sem_destroy(&shm->mutex);
-        munmap(shm, shm_size);
-        close(shm_fd);
-        shm_unlink(shm_name);
-        return 1;
+    printf("Archivo fuente: %s (%lld bytes)\n", filename, (long long)file_size);
+    printf("Archivo de salida: %s (preasignado)\n", ARCHIVO_SALIDA);
+    printf("Modo de anillo: %s\n", nombre_anillo(info.modo_anillo));
+    if (info.modo_anillo == MODO_ANILLO_REGISTROS) {
+        printf("Registros: hasta %d bytes de carga útil\n", info.registro_max);
+    } else {
+        printf("Layout de slots: %s\n", info.layout == LAYOUT_SOA ? "soa" : "aos");
     }
-
-    // Inicializar estructura de datos compartidos 
-    strncpy(shm->filename, filename, MAX_FILENAME - 1);
-    shm->filename[MAX_FILENAME - 1] = '\0';
-    shm->buffer_size = (int)buffer_size;
-
-    for (int i = 0; i < buffer_size; i++) {
-        shm->buffer[i].valor = 0;
-        shm->buffer[i].posicion = -1;
-        shm->buffer[i].timestamp = 0;
+    printf("Carriles: %d de %d slots\n", info.carriles, info.capacidad / info.carriles);
+    printf("Bytes por slot: %.3f\n",
+           (double)calcular_buffer_bytes(info.layout, info.modo_anillo, info.capacidad) /
+           info.capacidad);
+    printf("Tamaño total de memoria: %zu bytes\n", info.tamano_segmento);
+    printf("Segmento: %s%s%s%s",
+           (info.opciones_segmento & SEGMENTO_HUGETLB) ? "hugetlbfs" : "/dev/shm",
+           (info.opciones_segmento & SEGMENTO_THP) ? " + thp" : "",
+           (info.opciones_segmento & SEGMENTO_POPULATE) ? " + populate" : "",
+           (info.opciones_segmento & SEGMENTO_MLOCK) ? " + mlock" : "");
+    if (info.pagina > 0) {
+        printf(" (páginas de %zu KB)", info.pagina / 1024);
+    }
+    if (info.nodo_numa >= 0) {
+        printf(", nodo NUMA %d", info.nodo_numa);
     }
+    printf("\n");
+    printf("\n");
     
     printf("Memoria compartida inicializada exitosamente\n");
 
-    // Limpiar recursos
-    munmap(shm, shm_size);
-    close(shm_fd);
-
     return 0;
-}
\ No newline at end of file
+}
@@ -1,46 +1,1181 @@
 #ifndef MEMORIA_COMPARTIDA_H
 #define MEMORIA_COMPARTIDA_H
 
+#include <pthread.h>
 #include <semaphore.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "histograma.h"
+#include "espera.h"
+#include "canal.h"
+#include "colores.h"
 
 #define MAX_FILENAME 256
-// Códigos de color ANSI
-#define COLOR_RESET   "\x1b[0m"
-#define COLOR_GREEN   "\x1b[32m"
-#define COLOR_CYAN    "\x1b[36m"
-#define COLOR_YELLOW  "\x1b[33m"
-#define COLOR_RED     "\x1b[31m"
-#define COLOR_BLUE    "\x1b[34m"
-#define COLOR_MAGENTA "\x1b[35m"
-#define COLOR_BOLD    "\x1b[1m"
-
-// Información de auditoría de cada carácter
+#define BUFFER_MAX   (1 << 30)   // Slots (o bytes) del anillo: la diferencia de tickets cabe en un int
+#define ARCHIVO_SALIDA "output_receptor.txt"
+
+// Modos de sincronización del anillo (elegidos por el inicializador)
+#define MODO_ANILLO_MUTEX    0   // Índices protegidos por shm->mutex
+#define MODO_ANILLO_LOCKFREE 1   // Secuencia por slot + fetch-add atómico
+#define MODO_ANILLO_DIFUSION 2   // Cada receptor lee todo con su propio cursor (un carril)
+#define MODO_ANILLO_REGISTROS 3  // Registros de largo variable en un anillo de bytes (ver registros.h)
+
+// Disposición de los slots dentro de shm->buffer
+#define LAYOUT_AOS 0             // Arreglo de char_info_t
+#define LAYOUT_SOA 1             // Arreglos separados: posiciones, marcas, secuencias, valores
+#define SLOTS_POR_BLOQUE 64      // Slots que comparten una marca de tiempo (SOA)
+
+#define MAX_HISTOGRAMAS 32       // Receptores con histograma de latencia propio
+#define MAX_CARRILES    64       // Sub-anillos independientes (potencia de dos)
+
+// Opciones del segmento: las elige el inicializador y las aplica cada proceso al mapear
+#define SEGMENTO_HUGETLB  0x1    // Archivo en hugetlbfs en lugar de /dev/shm
+#define SEGMENTO_THP      0x2    // madvise(MADV_HUGEPAGE) sobre el segmento de /dev/shm
+#define SEGMENTO_POPULATE 0x4    // MAP_POPULATE: sin fallos de página en el camino caliente
+#define SEGMENTO_MLOCK    0x8    // mlock: el segmento no sale de la RAM
+#define DIR_HUGETLBFS "/dev/hugepages"  // Montaje por defecto (variable CANAL_HUGETLBFS)
+
+/*
+ * Cabecera autodescriptiva al comienzo del segmento. Quien se conecta la
+ * valida antes de leer cualquier otro campo: la versión sube con cada
+ * cambio incompatible del bloque de control o de un anillo, y las
+ * características marcan lo que usa este segmento, así que un binario que
+ * no conoce un modo nuevo lo rechaza en lugar de malinterpretarlo. La
+ * magia se escribe al final de la creación: sin ella el segmento está a
+ * medio inicializar.
+ */
+#define SEGMENTO_MAGIA   0x4C4E4143u  // "CANL" en little-endian
+#define SEGMENTO_VERSION 4
+
+#define CARACT_COMPACTO  0x01    // Bloque de control sin relleno (-DCONTROL_COMPACTO)
+#define CARACT_SOA       0x02    // Slots en LAYOUT_SOA
+#define CARACT_DIFUSION  0x04    // Anillo MODO_ANILLO_DIFUSION
+#define CARACT_REGISTROS 0x08    // Anillo MODO_ANILLO_REGISTROS
+#define CARACT_HUGETLB   0x10    // Segmento en hugetlbfs
+#define CARACT_CONOCIDAS 0x1f
+
+typedef struct {
+    uint32_t magia;           // SEGMENTO_MAGIA
+    uint32_t version;         // SEGMENTO_VERSION
+    uint32_t caracteristicas; // CARACT_*
+    uint32_t tamano_control;  // sizeof(shared_mem_t) de quien lo creó
+    uint64_t tamano_total;    // Bytes del segmento (lo que informa fstat)
+} cabecera_segmento_t;
+
+#ifdef CONTROL_COMPACTO
+#define CARACT_COMPILADAS CARACT_COMPACTO
+#else
+#define CARACT_COMPILADAS 0
+#endif
+
+// Información de auditoría de cada carácter (campos de mayor a menor: 24 bytes por slot)
 typedef struct {
-    char valor; 
-    int posicion;
-    time_t timestamp;
+    int64_t posicion;         // Offset del carácter en el archivo fuente
+    uint64_t timestamp_ns;    // CLOCK_MONOTONIC al publicar en el anillo
+    int secuencia;            // Solo modo lock-free: ticket que habilita el slot
+    char valor;
 } char_info_t;
 
-// Estructura de la memoria compartida
+/*
+ * Alineación de las regiones del bloque de control a líneas de caché, para
+ * que las escrituras de un lado no invaliden la línea que sondea el otro.
+ * Compilar con -DCONTROL_COMPACTO quita el relleno y reproduce la
+ * disposición empaquetada (ver make bench-falso-compartir).
+ */
+#define LINEA_CACHE 64
+#ifdef CONTROL_COMPACTO
+#define ALINEADO_LINEA
+#else
+#define ALINEADO_LINEA __attribute__((aligned(LINEA_CACHE)))
+#endif
+
+/*
+ * Carril: tramo del buffer con índices y semáforos propios. Cada emisor se
+ * asocia a un carril al registrarse y los receptores drenan el suyo y roban
+ * de los demás, así que la contención crece con los carriles y no con el
+ * número total de procesos. Cada campo ocupa su propia línea: el índice de
+ * escritura solo lo tocan los emisores y el de lectura solo los receptores.
+ *
+ * Los tickets y las secuencias son contadores de 32 bits que dan la vuelta
+ * (se compila con -fwrapv): deben caber en una palabra de futex, y como la
+ * capacidad es una potencia de dos que divide 2^32, el slot de un ticket y
+ * la diferencia entre dos tickets siguen siendo correctos al desbordar. Por
+ * eso nunca se comparan con < sino por su diferencia. Lo que sí es absoluto
+ * (offsets en el archivo, totales) es de 64 bits.
+ */
+typedef struct {
+    sem_t espacios_libres ALINEADO_LINEA;    // Esperan los emisores, publican los receptores
+    sem_t espacios_ocupados ALINEADO_LINEA;  // Esperan los receptores, publican los emisores
+    pthread_mutex_t mutex ALINEADO_LINEA;    // Protege los índices del carril (modo mutex, robusto)
+    int write_index ALINEADO_LINEA;          // Lado productor: próximo ticket de escritura
+    int read_index ALINEADO_LINEA;           // Lado consumidor: próximo ticket de lectura
+    int liberado ALINEADO_LINEA;             // Modo registros: bytes devueltos a los emisores
+} ALINEADO_LINEA carril_t;
+
+#define MAX_REGISTROS    256     // Procesos con contadores propios en el segmento
+#define PROCESO_EMISOR   1
+#define PROCESO_RECEPTOR 2
+
+// Valores de proceso_t.activo
+#define PROCESO_TERMINADO 0      // Salió por su cuenta
+#define PROCESO_ACTIVO    1
+#define PROCESO_CAIDO     2      // Murió y el supervisor recuperó su operación en curso
+
+/*
+ * Fases de la operación en curso de un proceso sobre su carril. Un emisor
+ * toma unidades de espacios_libres, reclama tickets, escribe los slots y
+ * publica espacios_ocupados; un receptor hace lo mismo con los semáforos
+ * intercambiados. Si el proceso muere, el supervisor completa la fase en
+ * la que quedó (ver recuperacion.h).
+ */
+#define FASE_LIBRE    0          // Sin operación en curso
+#define FASE_UNIDADES 1          // vuelo_n unidades tomadas, sin tickets
+#define FASE_TICKETS  2          // Tickets [vuelo_primero, +vuelo_n) reclamados, slots en proceso
+#define FASE_PUBLICAR 3          // Slots listos, faltan vuelo_n unidades por publicar
+
+/*
+ * Registro de un proceso, en su propia línea: solo lo escriben el proceso
+ * y sus hilos, así que sumar contadores no compite con otros procesos y el
+ * monitor los lee sin bloquear. Un proceso con varios hilos de trabajo
+ * tiene además un registro por hilo, que apunta con principal al del
+ * proceso y guarda solo la operación en curso (para recuperarla si el
+ * proceso muere), la espera y el latido del hilo: bytes, lotes y esperas
+ * se suman directo en el registro del proceso, con una suma atómica por
+ * lote. Los procesos que no alcanzan registro comparten uno de desborde
+ * por tipo (sin recuperación ante caídas).
+ */
 typedef struct {
-    sem_t espacios_libres; 
-    sem_t espacios_ocupados;
-    sem_t mutex;// Protege el acceso memoria compartida
-    sem_t file_mutex;
-    
+    int pid;
+    int tipo;                 // PROCESO_EMISOR o PROCESO_RECEPTOR
+    int principal;            // Registro del proceso: el propio, o el del proceso de un hilo de trabajo
+    int hilos;                // En el registro del proceso: hilos de trabajo registrados, él incluido
+    int carril;
+    int activo;               // PROCESO_* (el registro se conserva al terminar)
+    int esperando;            // 1 mientras espera espacio (emisor) o datos (receptor)
+    int fase;                 // FASE_* de la operación en curso
+    int vuelo_carril;         // Carril de la operación en curso (puede ser robado)
+    int vuelo_primero;
+    int vuelo_n;
+    int cursor;               // Difusión: receptor, próximo ticket a leer; emisor, menor cursor visto
+    int64_t dormido_en;       // Offset del futex de secuencia en que duerme (0 = ninguno)
+    uint64_t latido;          // Ciclos completados: si no avanza, el proceso está detenido
+    uint64_t bytes;           // Caracteres escritos o leídos (por todos sus hilos)
+    uint64_t lotes;           // Ciclos con transferencia
+    uint64_t esperas;         // Veces que tuvo que dormir
+} ALINEADO_LINEA proceso_t;
+
+// Estructura de la memoria compartida
+typedef struct shared_mem {
+    cabecera_segmento_t cabecera;  // Siempre primero: es lo único que se lee sin validar
+
+    // Configuración: la escribe el inicializador y después solo se lee
     char filename[MAX_FILENAME];  
+    char output_filename[MAX_FILENAME];  // Salida preasignada (mismo tamaño)
+    int64_t file_size;
+    int modo_anillo;          // MODO_ANILLO_*
+    int layout;               // LAYOUT_AOS o LAYOUT_SOA
+    int opciones_segmento;    // SEGMENTO_*
+    int nodo_numa;            // Nodo al que se ligó la memoria, -1 = sin preferencia
+    size_t pagina_segmento;   // Tamaño de página del segmento (huge page en hugetlbfs)
+    int buffer_size;          // Potencia de dos, suma de todos los carriles
+    int n_carriles;           // Potencia de dos, elegido por el inicializador
+    int carril_size;          // buffer_size / n_carriles
+    int carril_mask;          // carril_size - 1
+
+    // Lado productor: los emisores lo modifican en cada ciclo
+    int64_t file_read_position ALINEADO_LINEA; // Próximo byte del archivo (fetch-add atómico)
+
+    // Lado consumidor: lo escriben los receptores al dormir, los emisores solo lo leen
+    int receptores_dormidos ALINEADO_LINEA;  // Receptores dormidos en aviso_datos (varios carriles)
+
+    // Despertares: solo se escriben cuando alguien duerme
+    int aviso_datos ALINEADO_LINEA;  // Futex que se incrementa al publicar si hay dormidos
+    int esperando_slot ALINEADO_LINEA;  // Procesos dormidos en el futex de una secuencia
+    int avance_cursores ALINEADO_LINEA; // Difusión: futex que se incrementa al avanzar un cursor
+    int emisores_frenados;              // Emisores dormidos en avance_cursores
+
+    // Difusión: tabla de suscriptores (cambia al entrar o salir un receptor)
+    int suscripciones ALINEADO_LINEA;   // Impar mientras un receptor se suscribe
+    int piso_difusion;                  // Desde dónde lee un receptor que llega sin otros activos
 
-    int file_read_position;
-    int write_index;          // Dónde escribir el próximo carácter
-    int read_index;           // Dónde leer el próximo carácter
-    int chars_transferidos;   // estadisticas
+    // Poco frecuente: registro de procesos y finalización (finalizar se lee en cada ciclo)
+    pthread_mutex_t mutex ALINEADO_LINEA;  // Protege finalizar y los contadores (modo mutex, robusto)
+    int finalizar;            // Senal finalizacion
+    int epoca_cierre;         // Futex de los vigías de cierre: sube en despertar_procesos y al cerrar uno
     int emisores_activos;
     int receptores_activos;
-    int finalizar;            // Senal finalizacion
+    int carriles_emisores;    // Asignación round-robin de carriles
+    int carriles_receptores;
+    int n_histogramas;
+    int n_procesos;           // Registros de procesos asignados (nunca se reutilizan)
+    int procesos_caidos;      // Procesos muertos recuperados por el supervisor
+    int slots_saltados;       // Huecos rellenados o slots sin leer liberados al recuperar
+
+    carril_t carriles[MAX_CARRILES];
+    proceso_t procesos[MAX_REGISTROS + 2];  // Los dos últimos son de desborde
+
+    // Latencias medidas por los receptores, un histograma por proceso
+    histograma_t residencia[MAX_HISTOGRAMAS];  // Publicación -> lectura del anillo
+    histograma_t extremo[MAX_HISTOGRAMAS];     // Publicación -> byte en la salida
 
-    int buffer_size;
-    char_info_t buffer[];
+    char_info_t buffer[] ALINEADO_LINEA;  // En SOA la región se reinterpreta (ver soa_*)
 } shared_mem_t;
 
-#endif
\ No newline at end of file
+_Static_assert(offsetof(shared_mem_t, cabecera) == 0, "la cabecera debe abrir el segmento");
+
+#ifndef CONTROL_COMPACTO
+#define LINEA_DE(campo) (offsetof(shared_mem_t, campo) / LINEA_CACHE)
+_Static_assert(sizeof(carril_t) % LINEA_CACHE == 0, "carril_t debe ocupar líneas completas");
+_Static_assert(offsetof(carril_t, read_index) - offsetof(carril_t, write_index) >= LINEA_CACHE,
+               "los índices de un carril no deben compartir línea");
+_Static_assert(sizeof(proceso_t) % LINEA_CACHE == 0, "proceso_t debe ocupar líneas completas");
+_Static_assert(offsetof(shared_mem_t, carriles) % LINEA_CACHE == 0 &&
+               offsetof(shared_mem_t, residencia) % LINEA_CACHE == 0 &&
+               offsetof(shared_mem_t, buffer) % LINEA_CACHE == 0,
+               "carriles, histogramas y buffer deben empezar en una línea");
+_Static_assert(LINEA_DE(file_read_position) > LINEA_DE(carril_mask) &&
+               LINEA_DE(receptores_dormidos) > LINEA_DE(file_read_position) &&
+               LINEA_DE(aviso_datos) > LINEA_DE(receptores_dormidos) &&
+               LINEA_DE(esperando_slot) > LINEA_DE(aviso_datos) &&
+               LINEA_DE(avance_cursores) > LINEA_DE(esperando_slot) &&
+               LINEA_DE(suscripciones) > LINEA_DE(emisores_frenados) &&
+               LINEA_DE(mutex) > LINEA_DE(suscripciones) &&
+               LINEA_DE(n_procesos) < LINEA_DE(carriles),
+               "las regiones productor/consumidor/poco frecuente no deben compartir líneas");
+#endif
+
+// Los modos lock-free y difusión publican cada slot con una secuencia
+static inline int anillo_con_secuencias(int modo_anillo) {
+    return modo_anillo == MODO_ANILLO_LOCKFREE || modo_anillo == MODO_ANILLO_DIFUSION;
+}
+
+static inline const char *nombre_anillo(int modo_anillo) {
+    switch (modo_anillo) {
+    case MODO_ANILLO_LOCKFREE: return "lockfree";
+    case MODO_ANILLO_DIFUSION: return "difusion";
+    case MODO_ANILLO_REGISTROS: return "registros";
+    default:                   return "mutex";
+    }
+}
+
+/*
+ * Layout SOA: la región del buffer contiene, en orden,
+ *   int64_t  posiciones[buffer_size]   (offset en el archivo fuente)
+ *   uint64_t marcas[buffer_size / 64]  (una marca por bloque de slots)
+ *   int      secuencias[buffer_size]   (solo lock-free y difusión)
+ *   char     valores[buffer_size]      (carga útil densa)
+ * Los arreglos de 8 bytes van primero para que todos queden alineados.
+ */
+static inline size_t soa_bytes_secuencias(int modo_anillo, int capacidad) {
+    return anillo_con_secuencias(modo_anillo) ? (size_t)capacidad * sizeof(int) : 0;
+}
+
+static inline size_t soa_bytes_marcas(int capacidad) {
+    return (size_t)((capacidad + SLOTS_POR_BLOQUE - 1) / SLOTS_POR_BLOQUE) * sizeof(uint64_t);
+}
+
+// Bytes que ocupa la región del buffer para una configuración dada
+static inline size_t calcular_buffer_bytes(int layout, int modo_anillo, int capacidad) {
+    if (modo_anillo == MODO_ANILLO_REGISTROS) {
+        return (size_t)capacidad;  // Anillo de bytes: la capacidad se mide en bytes
+    }
+    if (layout == LAYOUT_SOA) {
+        return soa_bytes_secuencias(modo_anillo, capacidad) +
+               (size_t)capacidad * sizeof(int64_t) +
+               soa_bytes_marcas(capacidad) + (size_t)capacidad;
+    }
+    return (size_t)capacidad * sizeof(char_info_t);
+}
+
+// Redondear un tamaño a la página del segmento (hugetlbfs exige múltiplos en ftruncate/munmap)
+static inline size_t alinear_segmento(size_t size, size_t pagina) {
+    return pagina > 1 ? (size + pagina - 1) / pagina * pagina : size;
+}
+
+static inline size_t calcular_shm_size(const shared_mem_t *shm) {
+    return alinear_segmento(sizeof(shared_mem_t) +
+                            calcular_buffer_bytes(shm->layout, shm->modo_anillo, shm->buffer_size),
+                            shm->pagina_segmento);
+}
+
+// Ruta del segmento cuando vive en hugetlbfs: <montaje>/<nombre sin '/'>
+static inline void ruta_hugetlbfs(const char *nombre, char *ruta, size_t len) {
+    const char *dir = getenv("CANAL_HUGETLBFS");
+    snprintf(ruta, len, "%s/%s", dir ? dir : DIR_HUGETLBFS, nombre + (nombre[0] == '/'));
+}
+
+// Abrir el segmento esté en hugetlbfs o en /dev/shm
+static inline int abrir_segmento(const char *nombre, int flags) {
+    char ruta[MAX_FILENAME + 64];
+    ruta_hugetlbfs(nombre, ruta, sizeof(ruta));
+    int fd = open(ruta, flags);
+    if (fd != -1) {
+        return fd;
+    }
+    return shm_open(nombre, flags, 0666);
+}
+
+// Eliminar el segmento de ambos lugares; devuelve 0 si existía en alguno
+static inline int eliminar_segmento(const char *nombre) {
+    char ruta[MAX_FILENAME + 64];
+    ruta_hugetlbfs(nombre, ruta, sizeof(ruta));
+    int en_huge = unlink(ruta);
+    int en_shm = shm_unlink(nombre);
+    return (en_huge == 0 || en_shm == 0) ? 0 : -1;
+}
+
+// Características de un segmento con esta configuración
+static inline uint32_t caracteristicas_segmento(int modo_anillo, int layout, int opciones) {
+    uint32_t c = CARACT_COMPILADAS;
+    if (modo_anillo == MODO_ANILLO_REGISTROS) {
+        c |= CARACT_REGISTROS;  // Anillo de bytes: el layout no aplica
+    } else if (layout == LAYOUT_SOA) {
+        c |= CARACT_SOA;
+    }
+    if (modo_anillo == MODO_ANILLO_DIFUSION) {
+        c |= CARACT_DIFUSION;
+    }
+    if (opciones & SEGMENTO_HUGETLB) {
+        c |= CARACT_HUGETLB;
+    }
+    return c;
+}
+
+/*
+ * Comprobar que el segmento mapeado (tamano bytes, según fstat) lo creó
+ * un inicializador compatible con este binario y que su configuración es
+ * coherente con su tamaño. Cada paso solo lee lo que el anterior ya
+ * validó. Imprime el motivo y devuelve -1 si no.
+ */
+static inline int validar_segmento(const shared_mem_t *shm, size_t tamano) {
+    const cabecera_segmento_t *cab = &shm->cabecera;
+    if (__atomic_load_n(&cab->magia, __ATOMIC_ACQUIRE) != SEGMENTO_MAGIA) {
+        fprintf(stderr, "Error: El segmento no tiene una cabecera válida "
+                        "(¿inicializador de otra versión o aún en creación?)\n");
+        return -1;
+    }
+    if (cab->version != SEGMENTO_VERSION) {
+        fprintf(stderr, "Error: Versión del segmento %u, este programa entiende la %d\n",
+                cab->version, SEGMENTO_VERSION);
+        return -1;
+    }
+    if (cab->tamano_control != sizeof(shared_mem_t)) {
+        fprintf(stderr, "Error: Bloque de control de %u bytes, este programa usa %zu "
+                        "(compilados con opciones distintas)\n",
+                cab->tamano_control, sizeof(shared_mem_t));
+        return -1;
+    }
+    if ((cab->caracteristicas & ~CARACT_CONOCIDAS) != 0 ||
+        (cab->caracteristicas & CARACT_COMPACTO) != CARACT_COMPILADAS) {
+        fprintf(stderr, "Error: Características del segmento no soportadas (0x%x)\n",
+                cab->caracteristicas);
+        return -1;
+    }
+    if (cab->tamano_total != tamano || tamano < sizeof(shared_mem_t)) {
+        fprintf(stderr, "Error: El segmento mide %zu bytes y su cabecera dice %llu\n",
+                tamano, (unsigned long long)cab->tamano_total);
+        return -1;
+    }
+    int capacidad = shm->buffer_size;
+    int carriles = shm->n_carriles;
+    if (capacidad <= 0 || capacidad > BUFFER_MAX || (capacidad & (capacidad - 1)) != 0 ||
+        carriles <= 0 || carriles > MAX_CARRILES || (carriles & (carriles - 1)) != 0 ||
+        carriles > capacidad || calcular_shm_size(shm) != tamano) {
+        fprintf(stderr, "Error: Configuración del segmento inconsistente "
+                        "(buffer %d, carriles %d, %zu bytes)\n", capacidad, carriles, tamano);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Conectarse al segmento con un solo fstat y un solo mmap, validando la
+ * cabecera antes de devolverlo. prot es PROT_READ o PROT_READ | PROT_WRITE;
+ * si fd no es NULL el descriptor queda abierto ahí.
+ */
+static inline shared_mem_t *adjuntar_segmento(const char *nombre, int prot, int *fd,
+                                              size_t *tamano) {
+    int shm_fd = abrir_segmento(nombre, (prot & PROT_WRITE) ? O_RDWR : O_RDONLY);
+    if (shm_fd == -1) {
+        perror("Error: No se puede abrir la memoria compartida");
+        fprintf(stderr, "¿Ejecutó el inicializador primero?\n");
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(shm_fd, &st) == -1) {
+        perror("Error al consultar la memoria compartida");
+        close(shm_fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(cabecera_segmento_t)) {
+        fprintf(stderr, "Error: El segmento mide %lld bytes, no alcanza para la cabecera\n",
+                (long long)st.st_size);
+        close(shm_fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    shared_mem_t *shm = mmap(NULL, size, prot, MAP_SHARED, shm_fd, 0);
+    if (shm == MAP_FAILED) {
+        perror("Error al mapear memoria compartida");
+        close(shm_fd);
+        return NULL;
+    }
+    if (validar_segmento(shm, size) < 0) {
+        munmap(shm, size);
+        close(shm_fd);
+        return NULL;
+    }
+
+    if (fd) {
+        *fd = shm_fd;
+    } else {
+        close(shm_fd);
+    }
+    *tamano = size;
+    return shm;
+}
+
+/*
+ * Aplicar al segmento ya mapeado las opciones del inicializador: prefaltar
+ * todas las páginas, bloquearlas en RAM y pedir páginas grandes
+ * transparentes. Un mlock fallido (límite RLIMIT_MEMLOCK) solo avisa.
+ */
+static inline void aplicar_opciones_segmento(shared_mem_t *shm, size_t size, int opciones) {
+    if (opciones & SEGMENTO_THP) {
+        madvise(shm, size, MADV_HUGEPAGE);
+    }
+    if (opciones & SEGMENTO_POPULATE) {
+        int prefaltado = 0;
+#ifdef MADV_POPULATE_WRITE
+        prefaltado = madvise(shm, size, MADV_POPULATE_WRITE) == 0;
+#endif
+        // Kernel sin MADV_POPULATE_WRITE (< 5.14): tocar una vez cada página
+        for (size_t i = 0; !prefaltado && i < size; i += 4096) {
+            (void)*(volatile const char *)((const char *)shm + i);
+        }
+    }
+    if ((opciones & SEGMENTO_MLOCK) && mlock(shm, size) == -1) {
+        perror("Aviso: mlock del segmento falló (revise ulimit -l)");
+    }
+}
+
+// Menor potencia de dos >= n
+static inline long redondear_potencia_dos(long n) {
+    long p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Slot del buffer que ocupa un ticket de un carril
+static inline int carril_slot(const shared_mem_t *shm, int carril, int ticket) {
+    return carril * shm->carril_size + (ticket & shm->carril_mask);
+}
+
+// Asignar un carril al registrarse (round-robin entre los procesos del mismo tipo)
+static inline int tomar_carril(shared_mem_t *shm, int *asignados) {
+    return __atomic_fetch_add(asignados, 1, __ATOMIC_RELAXED) & (shm->n_carriles - 1);
+}
+
+// Llenar un registro recién tomado como el de un proceso de un solo hilo (aún sin activar)
+static inline void iniciar_registro(shared_mem_t *shm, proceso_t *p, int tipo, int carril) {
+    p->pid = getpid();
+    p->tipo = tipo;
+    p->principal = (int)(p - shm->procesos);
+    __atomic_store_n(&p->hilos, 1, __ATOMIC_RELAXED);
+    p->carril = carril;
+    p->fase = FASE_LIBRE;
+}
+
+// Tomar el registro de contadores de este proceso
+static inline proceso_t *registrar_proceso(shared_mem_t *shm, int tipo, int carril) {
+    int i = __atomic_fetch_add(&shm->n_procesos, 1, __ATOMIC_RELAXED);
+    proceso_t *p = &shm->procesos[i < MAX_REGISTROS ? i : MAX_REGISTROS + tipo - 1];
+    iniciar_registro(shm, p, tipo, carril);
+    __atomic_store_n(&p->activo, PROCESO_ACTIVO, __ATOMIC_RELEASE);
+    return p;
+}
+
+static inline void salir_proceso(proceso_t *p) {
+    __atomic_store_n(&p->esperando, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->activo, PROCESO_TERMINADO, __ATOMIC_RELEASE);
+}
+
+// Un ciclo más del proceso (un solo escritor: basta un store)
+static inline void latir(proceso_t *p) {
+    __atomic_store_n(&p->latido, p->latido + 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Registro de la operación en curso. Cada paso se anota justo después de
+ * hacerlo sobre el semáforo o el índice, de modo que una caída entre ambos
+ * pierde a lo sumo una unidad y nunca hace que el supervisor la duplique.
+ */
+static inline void vuelo_unidades(proceso_t *p, int carril, int n) {
+    __atomic_store_n(&p->vuelo_carril, carril, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->vuelo_n, n, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->fase, FASE_UNIDADES, __ATOMIC_RELEASE);
+}
+
+static inline void vuelo_tickets(proceso_t *p, int primero) {
+    __atomic_store_n(&p->vuelo_primero, primero, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->fase, FASE_TICKETS, __ATOMIC_RELEASE);
+}
+
+static inline void vuelo_publicar(proceso_t *p) {
+    __atomic_store_n(&p->fase, FASE_PUBLICAR, __ATOMIC_RELEASE);
+}
+
+// Suma relajada: la línea es del propio proceso (la comparten a lo sumo sus hilos)
+static inline void contador_sumar(uint64_t *contador, uint64_t n) {
+    __atomic_fetch_add(contador, n, __ATOMIC_RELAXED);
+}
+
+// Secuencialmente consistente: el finalizador decide a quién despertar con esta marca
+static inline void marcar_esperando(proceso_t *p, int esperando) {
+    __atomic_store_n(&p->esperando, esperando, __ATOMIC_SEQ_CST);
+}
+
+// Registros en uso (incluye los de desborde si se llegaron a usar)
+static inline int procesos_registrados(const shared_mem_t *shm) {
+    int n = __atomic_load_n(&shm->n_procesos, __ATOMIC_RELAXED);
+    return n <= MAX_REGISTROS ? n : MAX_REGISTROS + 2;
+}
+
+// Total de caracteres de un tipo de proceso (escritos por emisores o leídos por receptores)
+static inline uint64_t total_procesos(const shared_mem_t *shm, int tipo) {
+    uint64_t total = 0;
+    int n = procesos_registrados(shm);
+    for (int i = 0; i < n; i++) {
+        if (__atomic_load_n(&shm->procesos[i].tipo, __ATOMIC_RELAXED) == tipo) {
+            total += __atomic_load_n(&shm->procesos[i].bytes, __ATOMIC_RELAXED);
+        }
+    }
+    return total;
+}
+
+/*
+ * Menor cursor entre los receptores suscritos (modo difusión), o el piso si
+ * no hay ninguno. La tabla se recorre sin bloquear; si mientras tanto un
+ * receptor se suscribió (suscripciones cambió o es impar) se vuelve a
+ * recorrer, así nunca se usa un mínimo que ignore a un recién llegado.
+ */
+static inline int difusion_minimo(shared_mem_t *shm) {
+    for (;;) {
+        int generacion = __atomic_load_n(&shm->suscripciones, __ATOMIC_SEQ_CST);
+        if (generacion & 1) {
+            sched_yield();
+            continue;
+        }
+
+        int minimo = __atomic_load_n(&shm->piso_difusion, __ATOMIC_SEQ_CST);
+        int hay = 0;
+        int n = procesos_registrados(shm);
+        for (int i = 0; i < n && i < MAX_REGISTROS; i++) {
+            proceso_t *p = &shm->procesos[i];
+            if (__atomic_load_n(&p->tipo, __ATOMIC_RELAXED) != PROCESO_RECEPTOR ||
+                __atomic_load_n(&p->activo, __ATOMIC_SEQ_CST) != PROCESO_ACTIVO) {
+                continue;
+            }
+            int cursor = __atomic_load_n(&p->cursor, __ATOMIC_SEQ_CST);
+            if (!hay || cursor - minimo < 0) {
+                minimo = cursor;
+            }
+            hay = 1;
+        }
+
+        if (__atomic_load_n(&shm->suscripciones, __ATOMIC_SEQ_CST) == generacion) {
+            return minimo;
+        }
+    }
+}
+
+// Caracteres publicados y aún no leídos en un carril (en difusión, por el receptor más atrasado)
+static inline int ocupados_carril(shared_mem_t *shm, int c) {
+    int escritos = __atomic_load_n(&shm->carriles[c].write_index, __ATOMIC_ACQUIRE);
+    if (shm->modo_anillo == MODO_ANILLO_DIFUSION) {
+        return escritos - difusion_minimo(shm);
+    }
+    if (shm->modo_anillo == MODO_ANILLO_REGISTROS) {
+        // Bytes reservados, cabeceras incluidas, hasta que se liberan
+        return escritos - __atomic_load_n(&shm->carriles[c].liberado, __ATOMIC_ACQUIRE);
+    }
+    return escritos - __atomic_load_n(&shm->carriles[c].read_index, __ATOMIC_ACQUIRE);
+}
+
+// Caracteres publicados y aún no leídos en todos los carriles
+static inline int chars_en_anillo(shared_mem_t *shm) {
+    int total = 0;
+    for (int c = 0; c < shm->n_carriles; c++) {
+        total += ocupados_carril(shm, c);
+    }
+    return total;
+}
+
+static inline int64_t *soa_posiciones(shared_mem_t *shm) {
+    return (int64_t *)(void *)shm->buffer;
+}
+
+static inline uint64_t *soa_marcas(shared_mem_t *shm) {
+    return (uint64_t *)(void *)(soa_posiciones(shm) + shm->buffer_size);
+}
+
+static inline int *soa_secuencias(shared_mem_t *shm) {
+    return (int *)(void *)((char *)soa_marcas(shm) + soa_bytes_marcas(shm->buffer_size));
+}
+
+static inline char *soa_valores(shared_mem_t *shm) {
+    return (char *)soa_secuencias(shm) + soa_bytes_secuencias(shm->modo_anillo, shm->buffer_size);
+}
+
+static inline int *secuencia_slot(shared_mem_t *shm, int pos) {
+    if (shm->layout == LAYOUT_SOA) {
+        return &soa_secuencias(shm)[pos];
+    }
+    return &shm->buffer[pos].secuencia;
+}
+
+// Escribir un slot; en SOA solo el primero de cada bloque o tramo marca el tiempo
+static inline void slot_escribir(shared_mem_t *shm, int pos, char valor, int64_t posicion,
+                                 uint64_t ahora, int primero) {
+    if (shm->layout == LAYOUT_SOA) {
+        soa_valores(shm)[pos] = valor;
+        soa_posiciones(shm)[pos] = posicion;
+        if (primero || (pos & (SLOTS_POR_BLOQUE - 1)) == 0) {
+            soa_marcas(shm)[pos / SLOTS_POR_BLOQUE] = ahora;
+        }
+        return;
+    }
+    shm->buffer[pos].valor = valor;
+    shm->buffer[pos].posicion = posicion;
+    shm->buffer[pos].timestamp_ns = ahora;
+}
+
+static inline void slot_leer(shared_mem_t *shm, int pos, canal_dato_t *salida) {
+    if (shm->layout == LAYOUT_SOA) {
+        salida->valor = soa_valores(shm)[pos];
+        salida->posicion = soa_posiciones(shm)[pos];
+        salida->marca_ns = soa_marcas(shm)[pos / SLOTS_POR_BLOQUE];
+        return;
+    }
+    salida->valor = shm->buffer[pos].valor;
+    salida->posicion = shm->buffer[pos].posicion;
+    salida->marca_ns = shm->buffer[pos].timestamp_ns;
+}
+
+// Reservar el histograma de latencia de este receptor (se comparte si hay más de MAX_HISTOGRAMAS)
+static inline int tomar_histograma(shared_mem_t *shm) {
+    return __atomic_fetch_add(&shm->n_histogramas, 1, __ATOMIC_RELAXED) % MAX_HISTOGRAMAS;
+}
+
+/*
+ * Tomar un mutex robusto. Si su dueño murió con él tomado, se marca
+ * consistente y se devuelve 1 para que el llamador repare lo que protegía.
+ */
+static inline int bloquear(pthread_mutex_t *mutex) {
+    if (pthread_mutex_lock(mutex) == EOWNERDEAD) {
+        pthread_mutex_consistent(mutex);
+        return 1;
+    }
+    return 0;
+}
+
+static inline int leer_finalizar(shared_mem_t *shm) {
+    if (shm->modo_anillo != MODO_ANILLO_MUTEX) {
+        return __atomic_load_n(&shm->finalizar, __ATOMIC_ACQUIRE);
+    }
+    bloquear(&shm->mutex);
+    int valor = shm->finalizar;
+    pthread_mutex_unlock(&shm->mutex);
+    return valor;
+}
+
+// Suma delta a un contador de procesos (emisores/receptores activos); al
+// salir despierta al finalizador, que duerme en el futex del contador
+static inline void ajustar_contador(shared_mem_t *shm, int *contador, int delta) {
+    if (shm->modo_anillo != MODO_ANILLO_MUTEX) {
+        __atomic_fetch_add(contador, delta, __ATOMIC_ACQ_REL);
+    } else {
+        bloquear(&shm->mutex);
+        __atomic_store_n(contador, *contador + delta, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&shm->mutex);
+    }
+    if (delta < 0) {
+        futex_despertar(contador);
+    }
+}
+
+/*
+ * Anillo lock-free (estilo Vyukov), uno por carril. El slot i de un carril
+ * empieza con secuencia i. Un productor con ticket t espera secuencia == t,
+ * escribe y publica t + 1. Un consumidor con ticket t espera
+ * secuencia == t + 1, lee y libera el slot para la siguiente vuelta con
+ * t + carril_size. Los semáforos espacios_libres/espacios_ocupados del
+ * carril siguen contando huecos y datos, así que
+ * solo bloquean cuando el anillo está lleno o vacío; la espera sobre la
+ * secuencia cubre el caso en que otro proceso aún no termina con el slot.
+ *
+ * Un lote de n caracteres reclama n tickets contiguos con un solo fetch-add;
+ * sus caracteres ocupan posiciones consecutivas del archivo desde posicion.
+ * Ambas funciones devuelven el primer ticket, o -1 si se activó la
+ * finalización mientras se esperaba un slot.
+ */
+/*
+ * Esperar a que la secuencia de un slot llegue al valor esperado: girar
+ * según la política y después dormir en el futex de la propia secuencia.
+ * El contador esperando_slot permite que quien publica solo haga la llamada
+ * FUTEX_WAKE cuando de verdad hay alguien durmiendo. Antes de dormir el
+ * dueño anota en su registro qué secuencia espera, para que el finalizador
+ * la despierte en vez de dejarlo hasta el plazo del futex.
+ */
+static inline int esperar_secuencia(shared_mem_t *shm, int *secuencia, int esperada,
+                                    const espera_t *espera, proceso_t *dueno) {
+    unsigned int spins = 0;
+
+    for (;;) {
+        int actual = __atomic_load_n(secuencia, __ATOMIC_ACQUIRE);
+        if (actual == esperada) {
+            return 0;
+        }
+        if (__atomic_load_n(&shm->finalizar, __ATOMIC_RELAXED)) {
+            return -1;
+        }
+        if (seguir_girando(espera, spins)) {
+            cpu_relax(&spins);
+            continue;
+        }
+
+        if (dueno) {
+            __atomic_store_n(&dueno->dormido_en, (char *)secuencia - (char *)shm, __ATOMIC_SEQ_CST);
+        }
+        __atomic_fetch_add(&shm->esperando_slot, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(secuencia, __ATOMIC_SEQ_CST) == actual &&
+            !__atomic_load_n(&shm->finalizar, __ATOMIC_SEQ_CST)) {
+            futex_esperar(secuencia, actual);
+        }
+        __atomic_fetch_sub(&shm->esperando_slot, 1, __ATOMIC_RELAXED);
+        if (dueno) {
+            __atomic_store_n(&dueno->dormido_en, 0, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// Publicar una secuencia y despertar a quien duerma en ella, si hay alguien
+static inline void publicar_secuencia(shared_mem_t *shm, int *secuencia, int valor) {
+    __atomic_store_n(secuencia, valor, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&shm->esperando_slot, __ATOMIC_SEQ_CST) > 0) {
+        futex_despertar(secuencia);
+    }
+}
+
+static inline int anillo_lf_escribir(shared_mem_t *shm, int carril, const char *valores, int n,
+                                     int64_t posicion, const espera_t *espera, proceso_t *dueno) {
+    carril_t *c = &shm->carriles[carril];
+    int primero = __atomic_fetch_add(&c->write_index, n, __ATOMIC_RELAXED);
+    vuelo_tickets(dueno, primero);
+    uint64_t ahora = reloj_ns();
+
+    for (int i = 0; i < n; i++) {
+        int ticket = primero + i;
+        int pos = carril_slot(shm, carril, ticket);
+        int *secuencia = secuencia_slot(shm, pos);
+
+        if (esperar_secuencia(shm, secuencia, ticket, espera, dueno) < 0) {
+            return -1;
+        }
+        slot_escribir(shm, pos, valores[i], posicion + i, ahora, i == 0);
+        publicar_secuencia(shm, secuencia, ticket + 1);
+    }
+    vuelo_publicar(dueno);
+
+    return primero;
+}
+
+static inline int anillo_lf_leer(shared_mem_t *shm, int carril, canal_dato_t *salida, int n,
+                                 const espera_t *espera, proceso_t *dueno) {
+    carril_t *c = &shm->carriles[carril];
+    int primero = __atomic_fetch_add(&c->read_index, n, __ATOMIC_RELAXED);
+    vuelo_tickets(dueno, primero);
+
+    for (int i = 0; i < n; i++) {
+        int ticket = primero + i;
+        int pos = carril_slot(shm, carril, ticket);
+        int *secuencia = secuencia_slot(shm, pos);
+
+        if (esperar_secuencia(shm, secuencia, ticket + 1, espera, dueno) < 0) {
+            return -1;
+        }
+        slot_leer(shm, pos, &salida[i]);
+        publicar_secuencia(shm, secuencia, ticket + shm->carril_size);
+    }
+    vuelo_publicar(dueno);
+
+    return primero;
+}
+
+/*
+ * El dueño del mutex de un carril murió con él tomado (modo mutex). Solo
+ * quien tiene el mutex puede estar en FASE_TICKETS sobre el carril, y los
+ * índices avanzan una sola vez al final del lote, así que basta ver si el
+ * índice de su lado ya cubre sus tickets para saber en qué fase quedó.
+ */
+static inline void reparar_carril(shared_mem_t *shm, int carril) {
+    carril_t *c = &shm->carriles[carril];
+    int n = procesos_registrados(shm);
+    for (int i = 0; i < n && i < MAX_REGISTROS; i++) {
+        proceso_t *p = &shm->procesos[i];
+        if (p->activo != PROCESO_ACTIVO || p->fase != FASE_TICKETS || p->vuelo_carril != carril) {
+            continue;
+        }
+        int indice = p->tipo == PROCESO_EMISOR ? c->write_index : c->read_index;
+        if (shm->modo_anillo == MODO_ANILLO_REGISTROS) {
+            // En modo registros se sigue en FASE_TICKETS fuera del mutex: solo
+            // el muerto puede tener un ticket que el índice aún no pasó
+            if (indice - p->vuelo_primero <= 0) {
+                p->fase = FASE_LIBRE;
+            }
+            continue;
+        }
+        p->fase = indice == p->vuelo_primero ? FASE_UNIDADES : FASE_PUBLICAR;
+    }
+}
+
+static inline void bloquear_carril(shared_mem_t *shm, int carril) {
+    if (bloquear(&shm->carriles[carril].mutex)) {
+        reparar_carril(shm, carril);
+    }
+}
+
+/*
+ * Escritura/lectura de un lote en un carril con la sincronización del modo
+ * configurado. El llamador ya reservó n unidades del semáforo
+ * correspondiente del carril; la publicación (sem_post del otro semáforo)
+ * queda a su cargo. Los pasos se anotan en el registro del dueño.
+ */
+static inline int anillo_escribir(shared_mem_t *shm, int carril, const char *valores, int n,
+                                  int64_t posicion, const espera_t *espera, proceso_t *dueno) {
+    if (shm->modo_anillo == MODO_ANILLO_LOCKFREE) {
+        return anillo_lf_escribir(shm, carril, valores, n, posicion, espera, dueno);
+    }
+
+    carril_t *c = &shm->carriles[carril];
+    bloquear_carril(shm, carril);
+    uint64_t ahora = reloj_ns();
+    int primero = c->write_index;
+    vuelo_tickets(dueno, primero);
+    for (int i = 0; i < n; i++) {
+        slot_escribir(shm, carril_slot(shm, carril, primero + i), valores[i],
+                      posicion + i, ahora, i == 0);
+    }
+    __atomic_store_n(&c->write_index, primero + n, __ATOMIC_RELEASE);
+    vuelo_publicar(dueno);
+    pthread_mutex_unlock(&c->mutex);
+
+    return primero;
+}
+
+static inline int anillo_leer(shared_mem_t *shm, int carril, canal_dato_t *salida, int n,
+                              const espera_t *espera, proceso_t *dueno) {
+    if (shm->modo_anillo == MODO_ANILLO_LOCKFREE) {
+        return anillo_lf_leer(shm, carril, salida, n, espera, dueno);
+    }
+
+    carril_t *c = &shm->carriles[carril];
+    bloquear_carril(shm, carril);
+    int primero = c->read_index;
+    vuelo_tickets(dueno, primero);
+    for (int i = 0; i < n; i++) {
+        slot_leer(shm, carril_slot(shm, carril, primero + i), &salida[i]);
+    }
+    __atomic_store_n(&c->read_index, primero + n, __ATOMIC_RELEASE);
+    vuelo_publicar(dueno);
+    pthread_mutex_unlock(&c->mutex);
+
+    return primero;
+}
+
+// Tomar sin bloquear hasta max unidades más para la operación en curso;
+// devuelve el total de unidades que lleva
+static inline int tomar_vuelo(sem_t *sem, proceso_t *p, int max) {
+    int n = p->vuelo_n;
+    for (int i = 0; i < max && sem_trywait(sem) == 0; i++) {
+        __atomic_store_n(&p->vuelo_n, ++n, __ATOMIC_RELEASE);
+    }
+    return n;
+}
+
+// Publicar las unidades pendientes de la operación en curso y cerrarla
+static inline void publicar_vuelo(sem_t *sem, proceso_t *p) {
+    for (int n = p->vuelo_n; n > 0; n--) {
+        __atomic_store_n(&p->vuelo_n, n - 1, __ATOMIC_RELEASE);
+        sem_post(sem);
+    }
+    __atomic_store_n(&p->fase, FASE_LIBRE, __ATOMIC_RELEASE);
+}
+
+// Publicar n unidades de un semáforo
+static inline void publicar(sem_t *sem, int n) {
+    for (int i = 0; i < n; i++) {
+        sem_post(sem);
+    }
+}
+
+// Despertar a los receptores dormidos esperando datos de cualquier carril
+static inline void avisar_receptores(shared_mem_t *shm) {
+    __atomic_fetch_add(&shm->aviso_datos, 1, __ATOMIC_SEQ_CST);
+    futex_despertar(&shm->aviso_datos);
+}
+
+// Commit del lote en curso de un emisor; solo hay llamada al sistema extra si alguien duerme
+static inline void publicar_datos(shared_mem_t *shm, int carril, proceso_t *p) {
+    publicar_vuelo(&shm->carriles[carril].espacios_ocupados, p);
+    if (shm->n_carriles > 1 && __atomic_load_n(&shm->receptores_dormidos, __ATOMIC_SEQ_CST) > 0) {
+        avisar_receptores(shm);
+    }
+}
+
+// Tomar una unidad de datos de cualquier carril empezando por el propio
+static inline int robar_dato(shared_mem_t *shm, int propio) {
+    for (int k = 0; k < shm->n_carriles; k++) {
+        int c = (propio + k) & (shm->n_carriles - 1);
+        if (sem_trywait(&shm->carriles[c].espacios_ocupados) == 0) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Tomar una unidad de datos para un receptor: primero de su carril y, si
+ * está vacío, de los demás. Con un solo carril equivale a esperar_unidad().
+ * Con varios no hay un semáforo en el que dormir, así que el receptor se
+ * anota en receptores_dormidos y duerme en el futex aviso_datos, que los
+ * emisores incrementan al publicar (protocolo de contador de eventos).
+ *
+ * Devuelve el carril del que tomó la unidad, o -1 si se activó finalizar.
+ * *durmio queda en 1 si tuvo que dormir (el llamador debe revisar finalizar).
+ */
+static inline int tomar_dato(shared_mem_t *shm, int propio, const espera_t *espera,
+                             int *durmio, const char *aviso) {
+    *durmio = 0;
+    if (shm->n_carriles == 1) {
+        int r = esperar_unidad(&shm->carriles[0].espacios_ocupados, espera, &shm->finalizar, aviso);
+        *durmio = r == 1;
+        return r < 0 ? -1 : 0;
+    }
+
+    unsigned int spins = 0;
+    for (;;) {
+        int c = robar_dato(shm, propio);
+        if (c >= 0) {
+            return c;
+        }
+        if (__atomic_load_n(&shm->finalizar, __ATOMIC_RELAXED)) {
+            return -1;
+        }
+        if (seguir_girando(espera, spins)) {
+            cpu_relax(&spins);
+            continue;
+        }
+
+        if (!*durmio && aviso) {
+            printf("%s", aviso);
+        }
+        *durmio = 1;
+        __atomic_fetch_add(&shm->receptores_dormidos, 1, __ATOMIC_SEQ_CST);
+        int aviso_visto = __atomic_load_n(&shm->aviso_datos, __ATOMIC_SEQ_CST);
+        c = robar_dato(shm, propio);
+        if (c < 0 && !__atomic_load_n(&shm->finalizar, __ATOMIC_SEQ_CST)) {
+            futex_esperar(&shm->aviso_datos, aviso_visto);
+        }
+        __atomic_fetch_sub(&shm->receptores_dormidos, 1, __ATOMIC_RELAXED);
+        if (c >= 0) {
+            return c;
+        }
+    }
+}
+
+/*
+ * Modo difusión (publicación/suscripción, estilo disruptor). Hay un solo
+ * carril y cada receptor suscrito lee todos los caracteres con su propio
+ * cursor, guardado en su registro de proceso; nadie copia ni libera slots.
+ * Los emisores reclaman tickets con un fetch-add sobre write_index y
+ * publican cada slot con secuencia ticket + 1, como en el modo lock-free,
+ * pero antes de escribir el ticket t esperan a que t - carril_size quede
+ * por detrás del cursor más atrasado. Los semáforos del carril no se usan.
+ */
+
+// Registrar un receptor; en difusión además suscribirlo con un cursor propio
+static inline proceso_t *suscribir_proceso(shared_mem_t *shm, int carril) {
+    if (shm->modo_anillo != MODO_ANILLO_DIFUSION) {
+        return registrar_proceso(shm, PROCESO_RECEPTOR, carril);
+    }
+
+    // Una suscripción a la vez: suscripciones queda impar mientras dura
+    int generacion;
+    do {
+        generacion = __atomic_load_n(&shm->suscripciones, __ATOMIC_RELAXED) & ~1;
+    } while (!__atomic_compare_exchange_n(&shm->suscripciones, &generacion, generacion + 1, 0,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    // Empezar en el receptor más atrasado: ningún emisor pudo pisar sus slots
+    int cursor = __atomic_load_n(&shm->piso_difusion, __ATOMIC_SEQ_CST);
+    int hay = 0;
+    int n = procesos_registrados(shm);
+    for (int i = 0; i < n && i < MAX_REGISTROS; i++) {
+        proceso_t *p = &shm->procesos[i];
+        if (p->tipo == PROCESO_RECEPTOR &&
+            __atomic_load_n(&p->activo, __ATOMIC_SEQ_CST) == PROCESO_ACTIVO) {
+            int otro = __atomic_load_n(&p->cursor, __ATOMIC_SEQ_CST);
+            if (!hay || otro - cursor < 0) {
+                cursor = otro;
+            }
+            hay = 1;
+        }
+    }
+
+    proceso_t *yo = NULL;
+    int i = __atomic_fetch_add(&shm->n_procesos, 1, __ATOMIC_RELAXED);
+    if (i < MAX_REGISTROS) {
+        yo = &shm->procesos[i];
+        iniciar_registro(shm, yo, PROCESO_RECEPTOR, carril);
+        __atomic_store_n(&yo->cursor, cursor, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&yo->activo, PROCESO_ACTIVO, __ATOMIC_SEQ_CST);
+    }
+    __atomic_store_n(&shm->suscripciones, generacion + 2, __ATOMIC_SEQ_CST);
+    return yo;  // NULL: sin registro propio no hay cursor (ver MAX_REGISTROS)
+}
+
+// Despertar a los emisores frenados por el receptor más atrasado, si hay alguno
+static inline void avisar_emisores(shared_mem_t *shm) {
+    if (__atomic_load_n(&shm->emisores_frenados, __ATOMIC_SEQ_CST) > 0) {
+        __atomic_fetch_add(&shm->avance_cursores, 1, __ATOMIC_SEQ_CST);
+        futex_despertar(&shm->avance_cursores);
+    }
+}
+
+/*
+ * Retirar el cursor de un receptor que sale o murió. Antes de que deje de
+ * contar se sube el piso hasta él: los emisores pudieron pisar todo lo
+ * anterior, así que un receptor que llegue sin otros activos empieza ahí.
+ */
+static inline void desuscribir(shared_mem_t *shm, proceso_t *p) {
+    if (shm->modo_anillo != MODO_ANILLO_DIFUSION) {
+        return;
+    }
+    int cursor = __atomic_load_n(&p->cursor, __ATOMIC_SEQ_CST);
+    int piso = __atomic_load_n(&shm->piso_difusion, __ATOMIC_SEQ_CST);
+    while (cursor - piso > 0 &&
+           !__atomic_compare_exchange_n(&shm->piso_difusion, &piso, cursor, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    }
+}
+
+// Salida de un receptor: en difusión su cursor deja de frenar a los emisores
+static inline void salir_receptor(shared_mem_t *shm, proceso_t *p) {
+    desuscribir(shm, p);
+    salir_proceso(p);
+    if (shm->modo_anillo == MODO_ANILLO_DIFUSION) {
+        avisar_emisores(shm);
+    }
+}
+
+/*
+ * Esperar a que el ticket de un emisor quepa detrás del receptor más
+ * atrasado. El mínimo se guarda en el cursor del propio emisor y solo se
+ * vuelve a calcular cuando ya no alcanza. Devuelve -1 si se activó finalizar.
+ */
+static inline int difusion_esperar_espacio(shared_mem_t *shm, int ticket, const espera_t *espera,
+                                           proceso_t *dueno) {
+    unsigned int spins = 0;
+
+    for (;;) {
+        if (ticket - dueno->cursor < shm->carril_size) {
+            return 0;
+        }
+        dueno->cursor = difusion_minimo(shm);
+        if (ticket - dueno->cursor < shm->carril_size) {
+            return 0;
+        }
+        if (__atomic_load_n(&shm->finalizar, __ATOMIC_RELAXED)) {
+            return -1;
+        }
+        if (seguir_girando(espera, spins)) {
+            cpu_relax(&spins);
+            continue;
+        }
+
+        __atomic_fetch_add(&shm->emisores_frenados, 1, __ATOMIC_SEQ_CST);
+        int visto = __atomic_load_n(&shm->avance_cursores, __ATOMIC_SEQ_CST);
+        dueno->cursor = difusion_minimo(shm);
+        if (ticket - dueno->cursor >= shm->carril_size &&
+            !__atomic_load_n(&shm->finalizar, __ATOMIC_SEQ_CST)) {
+            futex_esperar(&shm->avance_cursores, visto);
+        }
+        __atomic_fetch_sub(&shm->emisores_frenados, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Publicar un lote en difusión; devuelve el primer ticket o -1 si se activó finalizar
+static inline int difusion_escribir(shared_mem_t *shm, const char *valores, int n, int64_t posicion,
+                                    const espera_t *espera, proceso_t *dueno) {
+    vuelo_unidades(dueno, 0, n);
+    int primero = __atomic_fetch_add(&shm->carriles[0].write_index, n, __ATOMIC_RELAXED);
+    vuelo_tickets(dueno, primero);
+    uint64_t ahora = reloj_ns();
+
+    for (int i = 0; i < n; i++) {
+        int ticket = primero + i;
+        int pos = carril_slot(shm, 0, ticket);
+
+        if (difusion_esperar_espacio(shm, ticket, espera, dueno) < 0) {
+            return -1;
+        }
+        slot_escribir(shm, pos, valores[i], posicion + i, ahora, i == 0);
+        publicar_secuencia(shm, secuencia_slot(shm, pos), ticket + 1);
+    }
+    __atomic_store_n(&dueno->fase, FASE_LIBRE, __ATOMIC_RELEASE);
+
+    return primero;
+}
+
+/*
+ * Leer hasta max caracteres desde el cursor del receptor: se espera el
+ * primero y se agregan los siguientes que ya estén publicados. Avanzar el
+ * cursor es lo único que se escribe; devuelve cuántos se leyeron, o -1 si
+ * se activó finalizar. *durmio queda en 1 si el primero no estaba listo.
+ */
+static inline int difusion_leer(shared_mem_t *shm, canal_dato_t *salida, int max,
+                                const espera_t *espera, proceso_t *dueno, int *durmio) {
+    int cursor = dueno->cursor;
+    int *secuencia = secuencia_slot(shm, carril_slot(shm, 0, cursor));
+
+    *durmio = __atomic_load_n(secuencia, __ATOMIC_ACQUIRE) != cursor + 1;
+    if (*durmio && esperar_secuencia(shm, secuencia, cursor + 1, espera, dueno) < 0) {
+        return -1;
+    }
+
+    int n = 0;
+    do {
+        slot_leer(shm, carril_slot(shm, 0, cursor + n), &salida[n]);
+        n++;
+    } while (n < max &&
+             __atomic_load_n(secuencia_slot(shm, carril_slot(shm, 0, cursor + n)),
+                             __ATOMIC_ACQUIRE) == cursor + n + 1);
+
+    __atomic_store_n(&dueno->cursor, cursor + n, __ATOMIC_SEQ_CST);
+    avisar_emisores(shm);
+    return n;
+}
+
+#endif
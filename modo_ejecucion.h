@@ -0,0 +1,329 @@
+#ifndef MODO_EJECUCION_H
+#define MODO_EJECUCION_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "espera.h"
+#include "histograma.h"
+#include "bitacora.h"
+
+#define MAX_LOTE 4096
+
+#define MODO_MANUAL 0         // Un ciclo por tecla
+#define MODO_AUTO   1         // Un ciclo cada <ms>, con plazos absolutos
+#define MODO_MAX    2         // Sin pausas (auto:0 o max)
+#define MODO_TASA   3         // Balde de fichas a <bytes/s>
+#define MODO_ADAPTATIVO 4     // Balde de fichas cuya tasa sigue la ocupación del anillo
+
+#define TRAMO_SONDEO_US 10000 // MANUAL sin aviso de cierre: cada cuánto revisar finalizar
+
+// Hacia dónde mueve la ocupación cada papel (MODO_ADAPTATIVO)
+#define SENTIDO_EMISOR   (-1) // Llena el anillo: frena si está sobre el objetivo
+#define SENTIDO_RECEPTOR   1  // Lo vacía: acelera si está sobre el objetivo
+
+#define OBJETIVO_DEFECTO   50     // Porcentaje del anillo ocupado al que se apunta
+#define REGULAR_MS         10     // Periodo del controlador
+#define TASA_INICIAL       1e6    // Bytes por segundo antes de la primera medición
+#define TASA_MIN           1e3
+#define TASA_MAX           1e12
+#define GANANCIA_P         0.5    // Fracción de la tasa por unidad de error
+#define GANANCIA_I         50.0   // Fracción de la tasa por segundo y unidad de error
+
+// Modo de ejecución compartido por emisor y receptor
+typedef struct {
+    int tipo;
+    int intervalo_ms;
+    double tasa;              // Bytes por segundo (MODO_TASA; en ADAPTATIVO la vigente)
+    int lote;                 // Caracteres por ciclo (1 = sin lotes)
+    espera_t espera;          // Qué hacer con el anillo lleno/vacío
+    uint64_t plazo_ns;        // AUTO: próximo ciclo; TASA: instante en que el balde quedó vacío
+    double resto_ns;          // TASA: fracción de ns consumida y aún no sumada a plazo_ns
+    int *finalizar;           // Futex que corta las pausas al finalizar (NULL = no se corta)
+    int cierre_fd;            // MANUAL: legible al finalizar (canal_aviso_cierre; -1 = sondear)
+    int bitacora;             // Nivel de detalle de la consola (BITACORA_*)
+    long resumen_ms;          // Periodo de BITACORA_RESUMEN
+
+    // MODO_ADAPTATIVO: controlador PI de la tasa según la ocupación del anillo
+    double objetivo;          // Fracción del anillo ocupada a la que se apunta
+    int sentido;              // SENTIDO_EMISOR o SENTIDO_RECEPTOR (lo fija cada programa)
+    double tasa_base;         // Término integral, en bytes por segundo
+    uint64_t regulado_ns;     // Última corrección de la tasa
+    long transferidos;        // Caracteres desde la última corrección
+} modo_ejecucion_t;
+
+// Parsear los sufijos opcionales ":batch=<n>", ":espera=<política>" y ":log=<nivel>"
+static inline int parsear_opciones(const char *opciones, modo_ejecucion_t *modo) {
+    char copia[128];
+    strncpy(copia, opciones, sizeof(copia) - 1);
+    copia[sizeof(copia) - 1] = '\0';
+
+    if (copia[0] != '\0' && copia[0] != ':') {
+        fprintf(stderr, "Error: Opción inválida '%s'\n", copia);
+        return -1;
+    }
+
+    char *contexto;
+    for (char *opcion = strtok_r(copia, ":", &contexto); opcion;
+         opcion = strtok_r(NULL, ":", &contexto)) {
+        if (strncmp(opcion, "batch=", 6) == 0) {
+            char *endptr;
+            long lote = strtol(opcion + 6, &endptr, 10);
+            if (*endptr != '\0' || lote <= 0 || lote > MAX_LOTE) {
+                fprintf(stderr, "Error: El lote debe estar entre 1 y %d\n", MAX_LOTE);
+                return -1;
+            }
+            modo->lote = (int)lote;
+        } else if (strncmp(opcion, "espera=", 7) == 0) {
+            if (parsear_espera(opcion + 7, &modo->espera) < 0) {
+                fprintf(stderr, "Error: Espera inválida. Use 'bloqueo', 'spin' o 'adaptativa[/<spins>]'\n");
+                return -1;
+            }
+        } else if (strncmp(opcion, "log=", 4) == 0) {
+            if (bitacora_parsear(opcion + 4, &modo->bitacora, &modo->resumen_ms) < 0) {
+                fprintf(stderr, "Error: Log inválido. Use 'bytes', 'resumen[/<ms>]' o 'silencio'\n");
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "Error: Opción inválida '%s'. Use 'batch=<n>', 'espera=<política>' o 'log=<nivel>'\n", opcion);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Formatos aceptados:
+ *   auto:<ms>[:batch=<n>][:espera=<política>][:log=<nivel>]    (auto:0 equivale a max)
+ *   max[:batch=<n>][:espera=<política>][:log=<nivel>]
+ *   rate:<bytes/s>[k|M|G][:batch=<n>][:espera=<política>][:log=<nivel>]
+ *   manual[:batch=<n>][:espera=<política>][:log=<nivel>]
+ *   adaptive[:<objetivo>%][:batch=<n>][:espera=<política>][:log=<nivel>]
+ */
+static inline int parsear_modo(const char *modo_str, modo_ejecucion_t *modo) {
+    modo->tipo = MODO_MANUAL;
+    modo->intervalo_ms = 1000;
+    modo->tasa = 0;
+    modo->lote = 1;
+    modo->espera.politica = ESPERA_BLOQUEO;
+    modo->espera.spins = SPINS_POR_DEFECTO;
+    modo->plazo_ns = 0;
+    modo->resto_ns = 0;
+    modo->finalizar = NULL;
+    modo->cierre_fd = -1;
+    modo->bitacora = BITACORA_BYTES;
+    modo->resumen_ms = RESUMEN_MS_DEFECTO;
+    modo->objetivo = OBJETIVO_DEFECTO / 100.0;
+    modo->sentido = SENTIDO_EMISOR;
+    modo->tasa_base = 0;
+    modo->regulado_ns = 0;
+    modo->transferidos = 0;
+
+    if (strncmp(modo_str, "auto:", 5) == 0) {
+        char *endptr;
+        long intervalo = strtol(modo_str + 5, &endptr, 10);
+        if (endptr == modo_str + 5 || intervalo < 0 || intervalo > 3600000) {
+            fprintf(stderr, "Error: Intervalo debe estar entre 0 y 3600000 ms\n");
+            return -1;
+        }
+        modo->tipo = intervalo == 0 ? MODO_MAX : MODO_AUTO;
+        modo->intervalo_ms = (int)intervalo;
+        return parsear_opciones(endptr, modo);
+    }
+
+    if (strncmp(modo_str, "max", 3) == 0) {
+        modo->tipo = MODO_MAX;
+        return parsear_opciones(modo_str + 3, modo);
+    }
+
+    if (strncmp(modo_str, "rate:", 5) == 0) {
+        char *endptr;
+        double tasa = strtod(modo_str + 5, &endptr);
+        switch (*endptr) {
+        case 'k': case 'K': tasa *= 1e3; endptr++; break;
+        case 'm': case 'M': tasa *= 1e6; endptr++; break;
+        case 'g': case 'G': tasa *= 1e9; endptr++; break;
+        }
+        if (endptr == modo_str + 5 || !(tasa >= 0.001 && tasa <= 1e12)) {
+            fprintf(stderr, "Error: La tasa debe ser positiva (bytes por segundo)\n");
+            return -1;
+        }
+        modo->tipo = MODO_TASA;
+        modo->tasa = tasa;
+        return parsear_opciones(endptr, modo);
+    }
+
+    if (strncmp(modo_str, "manual", 6) == 0) {
+        return parsear_opciones(modo_str + 6, modo);
+    }
+
+    if (strncmp(modo_str, "adaptive", 8) == 0) {
+        const char *resto = modo_str + 8;
+        if (resto[0] == ':' && resto[1] >= '0' && resto[1] <= '9') {
+            char *endptr;
+            long objetivo = strtol(resto + 1, &endptr, 10);
+            if (*endptr == '%') {
+                endptr++;
+            }
+            if (objetivo < 1 || objetivo > 99 || (*endptr != '\0' && *endptr != ':')) {
+                fprintf(stderr, "Error: El objetivo debe estar entre 1%% y 99%% del anillo\n");
+                return -1;
+            }
+            modo->objetivo = objetivo / 100.0;
+            resto = endptr;
+        }
+        modo->tipo = MODO_ADAPTATIVO;
+        modo->tasa = TASA_INICIAL;
+        modo->tasa_base = TASA_INICIAL;
+        return parsear_opciones(resto, modo);
+    }
+
+    fprintf(stderr, "Error: Modo inválido. Use 'auto:<ms>', 'max', 'rate:<bytes/s>', 'adaptive[:<objetivo>%%]' o 'manual'\n");
+    return -1;
+}
+
+/*
+ * Dormir hasta un instante absoluto de CLOCK_MONOTONIC (sin deriva
+ * acumulada). Con modo->finalizar se duerme en ese futex, así que el
+ * finalizador corta la pausa al instante; devuelve 1 en ese caso.
+ */
+static inline int dormir_hasta(const modo_ejecucion_t *modo, uint64_t plazo_ns) {
+    if (modo->finalizar) {
+        return futex_esperar_hasta(modo->finalizar, 0, plazo_ns);
+    }
+    struct timespec ts = { (time_t)(plazo_ns / 1000000000ull), (long)(plazo_ns % 1000000000ull) };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    return 0;
+}
+
+/*
+ * Esperar el turno del próximo ciclo en los modos automáticos y devolver
+ * cuántos caracteres se pueden transferir en él (a lo sumo el lote), o 0
+ * si la pausa se cortó por la finalización.
+ *
+ * En MODO_TASA el balde se modela con el instante plazo_ns en que quedó
+ * vacío: las fichas disponibles son (ahora - plazo_ns) * tasa, con un tope
+ * de un lote para no acumular ráfagas tras una pausa. Se duerme hasta que
+ * haya al menos una ficha y consumir_turno() adelanta plazo_ns. MODO_ADAPTATIVO
+ * usa el mismo balde con la tasa que fija regular_tasa().
+ */
+static inline int esperar_turno(modo_ejecucion_t *modo) {
+    uint64_t ahora = reloj_ns();
+
+    if (modo->tipo == MODO_AUTO) {
+        uint64_t intervalo = (uint64_t)modo->intervalo_ms * 1000000ull;
+        // Al arrancar o con más de un ciclo de atraso, volver a tomar el reloj
+        if (modo->plazo_ns == 0 || modo->plazo_ns + intervalo < ahora) {
+            modo->plazo_ns = ahora + intervalo;
+        } else {
+            modo->plazo_ns += intervalo;
+        }
+        return dormir_hasta(modo, modo->plazo_ns) ? 0 : modo->lote;
+    }
+
+    if (modo->tipo == MODO_TASA || modo->tipo == MODO_ADAPTATIVO) {
+        double ns_por_byte = 1e9 / modo->tasa;
+        uint64_t rafaga = (uint64_t)(ns_por_byte * modo->lote);
+        if (modo->plazo_ns == 0) {
+            modo->plazo_ns = ahora;
+        } else if (modo->plazo_ns + rafaga < ahora) {
+            modo->plazo_ns = ahora - rafaga;
+        }
+
+        uint64_t listo = modo->plazo_ns + (uint64_t)ns_por_byte;
+        if (listo > ahora) {
+            if (dormir_hasta(modo, listo)) {
+                return 0;
+            }
+            ahora = reloj_ns();
+        }
+        double fichas = (double)(ahora - modo->plazo_ns) / ns_por_byte;
+        if (fichas < 1) {
+            return 1;
+        }
+        return fichas < modo->lote ? (int)fichas : modo->lote;
+    }
+
+    return modo->lote;
+}
+
+/*
+ * Descontar del balde los caracteres realmente transferidos en el ciclo. La
+ * fracción de nanosegundo que no entra en plazo_ns pasa al ciclo siguiente:
+ * truncarla en cada llamada adelantaría el balde y la tasa real quedaría
+ * por encima de la pedida (con lotes chicos y tasas altas, varios por ciento).
+ */
+static inline void consumir_turno(modo_ejecucion_t *modo, int n) {
+    if (modo->tipo == MODO_TASA || modo->tipo == MODO_ADAPTATIVO) {
+        double ns = n * 1e9 / modo->tasa + modo->resto_ns;
+        uint64_t enteros = (uint64_t)ns;
+        modo->resto_ns = ns - (double)enteros;
+        modo->plazo_ns += enteros;
+        modo->transferidos += n;
+    }
+}
+
+// En MODO_ADAPTATIVO, si ya pasó un periodo del controlador desde la última corrección
+static inline int toca_regular(const modo_ejecucion_t *modo) {
+    return modo->tipo == MODO_ADAPTATIVO &&
+           reloj_ns() - modo->regulado_ns >= (uint64_t)REGULAR_MS * 1000000ull;
+}
+
+/*
+ * Corregir la tasa del balde con la ocupación del anillo (0..1). El error
+ * ocupacion - objetivo, con el signo del papel, mueve la tasa de forma
+ * multiplicativa: el término integral (tasa_base) acumula el error en el
+ * tiempo y el proporcional reacciona al de este periodo. Así un emisor
+ * frena antes de que el anillo se llene y un receptor acelera cuando se
+ * acumula cola, sin fijar milisegundos a mano; la latencia de cola queda
+ * acotada por objetivo * capacidad / tasa.
+ *
+ * Contra la saturación del integrador la tasa base solo crece hasta el
+ * doble de lo que realmente se transfirió en el periodo: si el cuello de
+ * botella es otro (el anillo vacío, la CPU), no se acumula una tasa
+ * inalcanzable que tarde en bajar cuando la ocupación cambie. La medición
+ * nunca la recorta, porque un periodo sin CPU la haría caer en espiral.
+ *
+ * El integrador del receptor no baja por falta de cola: si ambos lados
+ * frenaran bajo el objetivo, la ocupación quedaría fija con cualquier
+ * caudal y el par derivaría hacia tasas bajas. Así el nivel lo fija el
+ * emisor y el receptor solo acelera cuando la cola crece.
+ */
+static inline void regular_tasa(modo_ejecucion_t *modo, double ocupacion) {
+    uint64_t ahora = reloj_ns();
+    if (modo->regulado_ns == 0) {
+        modo->regulado_ns = ahora;
+        modo->transferidos = 0;
+        return;
+    }
+    double dt = (double)(ahora - modo->regulado_ns) / 1e9;
+    double medida = modo->transferidos / dt;
+    modo->regulado_ns = ahora;
+    modo->transferidos = 0;
+
+    double error = modo->sentido * (ocupacion - modo->objetivo);
+    double acumulado = modo->sentido == SENTIDO_RECEPTOR && error < 0 ? 0 : error;
+    double paso = GANANCIA_I * acumulado * dt;
+    if (paso > 1) {
+        paso = 1;
+    } else if (paso < -0.5) {
+        paso = -0.5;
+    }
+    double base = modo->tasa_base * (1 + paso);
+    if (paso > 0 && base > 2 * medida) {
+        base = modo->tasa_base > 2 * medida ? modo->tasa_base : 2 * medida;
+    }
+    if (base < TASA_MIN) {
+        base = TASA_MIN;
+    } else if (base > TASA_MAX) {
+        base = TASA_MAX;
+    }
+    modo->tasa_base = base;
+
+    double tasa = base * (1 + GANANCIA_P * error);
+    modo->tasa = tasa < TASA_MIN ? TASA_MIN : tasa;
+}
+
+#endif
@@ -0,0 +1,270 @@
+// monitor.c - muestreo en vivo del segmento, solo lectura y sin tomar el mutex
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include "memoria_compartida.h"
+
+#define VISTA_TERMINAL 0
+#define VISTA_JSON     1
+
+volatile sig_atomic_t keep_running = 1;
+
+void signal_handler(int signum) {
+    (void)signum;
+    keep_running = 0;
+}
+
+// Bytes de cada registro en la muestra anterior, para calcular tasas por proceso
+static uint64_t bytes_previos[MAX_REGISTROS + 2];
+
+typedef struct {
+    double t;
+    uint64_t emitidos;
+    uint64_t recibidos;
+    int ocupados;
+    int emisores_esperando;
+    int receptores_esperando;
+    int activos;
+} muestra_t;
+
+// Leer todos los contadores sin bloquear: cada campo se carga de forma atómica
+static void tomar_muestra(shared_mem_t *shm, muestra_t *m) {
+    memset(m, 0, sizeof(*m));
+    m->t = reloj_ns() / 1e9;
+    m->ocupados = chars_en_anillo(shm);
+    int n = procesos_registrados(shm);
+    for (int i = 0; i < n; i++) {
+        proceso_t *p = &shm->procesos[i];
+        int tipo = __atomic_load_n(&p->tipo, __ATOMIC_RELAXED);
+        uint64_t bytes = __atomic_load_n(&p->bytes, __ATOMIC_RELAXED);
+        int activo = __atomic_load_n(&p->activo, __ATOMIC_ACQUIRE) == PROCESO_ACTIVO;
+        int esperando = activo && __atomic_load_n(&p->esperando, __ATOMIC_RELAXED);
+
+        if (tipo == PROCESO_EMISOR) {
+            m->emitidos += bytes;
+            m->emisores_esperando += esperando;
+        } else if (tipo == PROCESO_RECEPTOR) {
+            m->recibidos += bytes;
+            m->receptores_esperando += esperando;
+        }
+        m->activos += activo;
+    }
+}
+
+// Los registros de hilos de trabajo no se listan: sus contadores ya están en el del proceso
+static int es_proceso(shared_mem_t *shm, int i) {
+    return __atomic_load_n(&shm->procesos[i].principal, __ATOMIC_RELAXED) == i;
+}
+
+/*
+ * Estado de los hilos de un proceso: cuántos de sus registros activos están
+ * esperando y el latido más atrasado entre ellos, para que un hilo detenido
+ * se vea aunque los contadores vayan al registro del proceso.
+ */
+static void estado_hilos(shared_mem_t *shm, int principal, int *esperando, uint64_t *latido) {
+    *esperando = 0;
+    *latido = __atomic_load_n(&shm->procesos[principal].latido, __ATOMIC_RELAXED);
+    int n = procesos_registrados(shm);
+    for (int i = 0; i < n; i++) {
+        proceso_t *p = &shm->procesos[i];
+        if (__atomic_load_n(&p->principal, __ATOMIC_RELAXED) != principal ||
+            __atomic_load_n(&p->activo, __ATOMIC_ACQUIRE) != PROCESO_ACTIVO) {
+            continue;
+        }
+        *esperando += __atomic_load_n(&p->esperando, __ATOMIC_RELAXED) != 0;
+        uint64_t l = __atomic_load_n(&p->latido, __ATOMIC_RELAXED);
+        if (l < *latido) {
+            *latido = l;
+        }
+    }
+}
+
+static const char *nombre_tipo(int tipo) {
+    return tipo == PROCESO_EMISOR ? "emisor" : tipo == PROCESO_RECEPTOR ? "receptor" : "-";
+}
+
+static const char *nombre_estado(int activo) {
+    return activo == PROCESO_ACTIVO ? "activo" : activo == PROCESO_CAIDO ? "caído" : "terminó";
+}
+
+static void mostrar_terminal(shared_mem_t *shm, const muestra_t *m, const muestra_t *previa) {
+    double dt = m->t - previa->t;
+    int capacidad = shm->buffer_size;
+
+    printf("\x1b[H\x1b[2J");
+    printf(COLOR_BOLD COLOR_CYAN "=== MONITOR ===" COLOR_RESET "  (Ctrl+C para salir)\n\n");
+    printf("Ocupación: " COLOR_YELLOW "%d / %d (%.1f%%)\n" COLOR_RESET,
+           m->ocupados, capacidad, 100.0 * m->ocupados / capacidad);
+    for (int c = 0; c < shm->n_carriles; c++) {
+        printf("  carril %-3d %6d / %d\n", c, ocupados_carril(shm, c), shm->carril_size);
+    }
+    printf("Emitidos: " COLOR_YELLOW "%llu" COLOR_RESET " de %lld (%.0f bytes/s)\n",
+           (unsigned long long)m->emitidos, (long long)shm->file_size,
+           (m->emitidos - previa->emitidos) / dt);
+    printf("Recibidos: " COLOR_YELLOW "%llu" COLOR_RESET " (%.0f bytes/s)\n",
+           (unsigned long long)m->recibidos, (m->recibidos - previa->recibidos) / dt);
+    printf("Esperando: " COLOR_YELLOW "%d emisores, %d receptores" COLOR_RESET
+           " (%d dormidos en el aviso)\n", m->emisores_esperando, m->receptores_esperando,
+           __atomic_load_n(&shm->receptores_dormidos, __ATOMIC_RELAXED));
+    printf("Caídos recuperados: " COLOR_YELLOW "%d" COLOR_RESET " (slots saltados: %d)\n",
+           __atomic_load_n(&shm->procesos_caidos, __ATOMIC_RELAXED),
+           __atomic_load_n(&shm->slots_saltados, __ATOMIC_RELAXED));
+
+    printf("\n%-8s %-9s %-7s %-5s %-8s %-6s %14s %12s %10s %10s %10s\n",
+           "pid", "tipo", "carril", "hilos", "estado", "espera", "bytes", "bytes/s", "lotes",
+           "esperas", "latido");
+    int n = procesos_registrados(shm);
+    for (int i = 0; i < n; i++) {
+        proceso_t *p = &shm->procesos[i];
+        if (!es_proceso(shm, i)) {
+            continue;
+        }
+        uint64_t bytes = __atomic_load_n(&p->bytes, __ATOMIC_RELAXED);
+        int esperando;
+        uint64_t latido;
+        estado_hilos(shm, i, &esperando, &latido);
+        printf("%-8d %-9s %-7d %-5d %-8s %-6d %14llu %12.0f %10llu %10llu %10llu\n",
+               __atomic_load_n(&p->pid, __ATOMIC_RELAXED),
+               nombre_tipo(__atomic_load_n(&p->tipo, __ATOMIC_RELAXED)),
+               __atomic_load_n(&p->carril, __ATOMIC_RELAXED),
+               __atomic_load_n(&p->hilos, __ATOMIC_RELAXED),
+               nombre_estado(__atomic_load_n(&p->activo, __ATOMIC_RELAXED)),
+               esperando,
+               (unsigned long long)bytes, (bytes - bytes_previos[i]) / dt,
+               (unsigned long long)__atomic_load_n(&p->lotes, __ATOMIC_RELAXED),
+               (unsigned long long)__atomic_load_n(&p->esperas, __ATOMIC_RELAXED),
+               (unsigned long long)latido);
+        bytes_previos[i] = bytes;
+    }
+    fflush(stdout);
+}
+
+// Un objeto JSON por línea, para procesarlo con jq o cargarlo en un cuaderno
+static void mostrar_json(shared_mem_t *shm, const muestra_t *m, const muestra_t *previa) {
+    double dt = m->t - previa->t;
+
+    printf("{\"t\":%.3f,\"ocupados\":%d,\"capacidad\":%d,\"carriles\":[",
+           m->t, m->ocupados, shm->buffer_size);
+    for (int c = 0; c < shm->n_carriles; c++) {
+        printf("%s%d", c ? "," : "", ocupados_carril(shm, c));
+    }
+    printf("],\"emitidos\":%llu,\"recibidos\":%llu,\"tasa_emision\":%.0f,\"tasa_recepcion\":%.0f,"
+           "\"emisores_esperando\":%d,\"receptores_esperando\":%d,\"receptores_dormidos\":%d,"
+           "\"caidos\":%d,\"slots_saltados\":%d,\"procesos\":[",
+           (unsigned long long)m->emitidos, (unsigned long long)m->recibidos,
+           (m->emitidos - previa->emitidos) / dt, (m->recibidos - previa->recibidos) / dt,
+           m->emisores_esperando, m->receptores_esperando,
+           __atomic_load_n(&shm->receptores_dormidos, __ATOMIC_RELAXED),
+           __atomic_load_n(&shm->procesos_caidos, __ATOMIC_RELAXED),
+           __atomic_load_n(&shm->slots_saltados, __ATOMIC_RELAXED));
+
+    int n = procesos_registrados(shm);
+    int primero = 1;
+    for (int i = 0; i < n; i++) {
+        proceso_t *p = &shm->procesos[i];
+        if (!es_proceso(shm, i)) {
+            continue;
+        }
+        uint64_t bytes = __atomic_load_n(&p->bytes, __ATOMIC_RELAXED);
+        int esperando;
+        uint64_t latido;
+        estado_hilos(shm, i, &esperando, &latido);
+        printf("%s{\"pid\":%d,\"tipo\":\"%s\",\"carril\":%d,\"hilos\":%d,\"estado\":\"%s\","
+               "\"esperando\":%d,\"bytes\":%llu,\"tasa\":%.0f,\"lotes\":%llu,\"esperas\":%llu,"
+               "\"latido\":%llu}",
+               primero ? "" : ",",
+               __atomic_load_n(&p->pid, __ATOMIC_RELAXED),
+               nombre_tipo(__atomic_load_n(&p->tipo, __ATOMIC_RELAXED)),
+               __atomic_load_n(&p->carril, __ATOMIC_RELAXED),
+               __atomic_load_n(&p->hilos, __ATOMIC_RELAXED),
+               nombre_estado(__atomic_load_n(&p->activo, __ATOMIC_RELAXED)),
+               esperando,
+               (unsigned long long)bytes, (bytes - bytes_previos[i]) / dt,
+               (unsigned long long)__atomic_load_n(&p->lotes, __ATOMIC_RELAXED),
+               (unsigned long long)__atomic_load_n(&p->esperas, __ATOMIC_RELAXED),
+               (unsigned long long)latido);
+        bytes_previos[i] = bytes;
+        primero = 0;
+    }
+    printf("]}\n");
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "Uso: %s <identificador_shm> [intervalo_ms] [vista|json]\n", argv[0]);
+        fprintf(stderr, "Ejemplos:\n");
+        fprintf(stderr, "  %s /mi_shm              # Vista en terminal cada 500 ms\n", argv[0]);
+        fprintf(stderr, "  %s /mi_shm 100 json     # Una línea JSON cada 100 ms\n", argv[0]);
+        return 1;
+    }
+
+    const char *shm_name = argv[1];
+    long intervalo_ms = 500;
+    if (argc >= 3) {
+        char *endptr;
+        intervalo_ms = strtol(argv[2], &endptr, 10);
+        if (*endptr != '\0' || intervalo_ms < 1 || intervalo_ms > 3600000) {
+            fprintf(stderr, "Error: El intervalo debe estar entre 1 y 3600000 ms\n");
+            return 1;
+        }
+    }
+    int vista = VISTA_TERMINAL;
+    if (argc == 4) {
+        if (strcmp(argv[3], "json") == 0) {
+            vista = VISTA_JSON;
+        } else if (strcmp(argv[3], "vista") != 0) {
+            fprintf(stderr, "Error: Vista inválida. Use 'vista' o 'json'\n");
+            return 1;
+        }
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    // Solo lectura: el monitor nunca escribe en el segmento ni recorre el buffer
+    size_t shm_size;
+    shared_mem_t *shm = adjuntar_segmento(shm_name, PROT_READ, NULL, &shm_size);
+    if (!shm) {
+        return 1;
+    }
+
+    muestra_t previa, actual;
+    tomar_muestra(shm, &previa);
+    for (int i = 0; i < procesos_registrados(shm); i++) {
+        bytes_previos[i] = __atomic_load_n(&shm->procesos[i].bytes, __ATOMIC_RELAXED);
+    }
+
+    uint64_t plazo = reloj_ns();
+    while (keep_running) {
+        plazo += (uint64_t)intervalo_ms * 1000000ull;
+        struct timespec ts = { (time_t)(plazo / 1000000000ull), (long)(plazo % 1000000000ull) };
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        if (!keep_running) {
+            break;
+        }
+
+        tomar_muestra(shm, &actual);
+        if (vista == VISTA_JSON) {
+            mostrar_json(shm, &actual, &previa);
+        } else {
+            mostrar_terminal(shm, &actual, &previa);
+        }
+        previa = actual;
+
+        // Terminar cuando el finalizador ya actuó y no queda nadie registrado
+        if (__atomic_load_n(&shm->finalizar, __ATOMIC_ACQUIRE) && actual.activos == 0) {
+            break;
+        }
+    }
+
+    munmap(shm, shm_size);
+    return 0;
+}
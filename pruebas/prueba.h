@@ -0,0 +1,141 @@
+#ifndef PRUEBA_H
+#define PRUEBA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../canal.h"
+#include "../memoria_compartida.h"
+#include "../registros.h"
+
+/*
+ * Pruebas de libcanal: cada programa ejercita una llamada de la API sobre
+ * un canal dentro del propio proceso (emisor y receptor son dos conexiones
+ * del mismo proceso), informa cada verificación que falla y termina con
+ * código distinto de cero si hubo alguna. Cada canal usa un nombre de segmento propio, así que las pruebas
+ * pueden correr a la vez sin pisarse.
+ */
+
+static int pruebas_fallidas = 0;
+
+#define VERIFICAR(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: falló %s\n", __FILE__, __LINE__, #cond); \
+        pruebas_fallidas++; \
+    } \
+} while (0)
+
+#define VERIFICAR_IGUAL(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if (_a != _b) { \
+        fprintf(stderr, "%s:%d: %s = %lld, se esperaba %lld\n", __FILE__, __LINE__, #a, _a, _b); \
+        pruebas_fallidas++; \
+    } \
+} while (0)
+
+// Los cuatro modos del anillo, para recorrerlos en cada prueba
+static const int modos_prueba[] = { CANAL_MUTEX, CANAL_LOCKFREE, CANAL_DIFUSION, CANAL_REGISTROS };
+#define N_MODOS_PRUEBA ((int)(sizeof(modos_prueba) / sizeof(modos_prueba[0])))
+
+static inline const char *nombre_modo(int modo) {
+    switch (modo) {
+    case CANAL_LOCKFREE:  return "lockfree";
+    case CANAL_DIFUSION:  return "difusion";
+    case CANAL_REGISTROS: return "registros";
+    default:              return "mutex";
+    }
+}
+
+// Nombre de segmento único por programa, proceso y canal
+static inline const char *nombre_prueba(const char *prueba) {
+    static char nombre[64];
+    static int serie = 0;
+    snprintf(nombre, sizeof(nombre), "/prueba_%s_%d_%d", prueba, (int)getpid(), serie++);
+    return nombre;
+}
+
+// Canal nuevo con la configuración por defecto salvo modo, layout y capacidad
+static inline canal_t *crear_prueba(const char *nombre, int modo, int layout, long capacidad) {
+    canal_config_t cfg;
+    canal_config_defecto(&cfg);
+    cfg.modo_anillo = modo;
+    cfg.layout = layout;
+    cfg.capacidad = capacidad;
+    return canal_crear(nombre, &cfg);
+}
+
+// Bytes reconocibles para un tramo del flujo: el valor depende de la posición
+static inline char byte_prueba(int64_t posicion) {
+    return (char)('a' + posicion % 26);
+}
+
+static inline void llenar_prueba(char *datos, int n, int64_t posicion) {
+    for (int i = 0; i < n; i++) {
+        datos[i] = byte_prueba(posicion + i);
+    }
+}
+
+// Recibir exactamente n bytes en lotes de hasta max; -1 si la recepción falla
+static inline int recibir_todo(canal_t *c, canal_dato_t *salida, int n, int max) {
+    int recibidos = 0;
+    while (recibidos < n) {
+        int lote = n - recibidos < max ? n - recibidos : max;
+        int r = canal_recibir_lote(c, salida + recibidos, lote);
+        if (r <= 0) {
+            return -1;
+        }
+        recibidos += r;
+    }
+    return recibidos;
+}
+
+// Verificar que salida trae el tramo [posicion, posicion + n) del flujo, en orden
+static inline int tramo_correcto(const canal_dato_t *salida, int n, int64_t posicion) {
+    for (int i = 0; i < n; i++) {
+        if (salida[i].posicion != posicion + i || salida[i].valor != byte_prueba(posicion + i) ||
+            salida[i].marca_ns == 0) {
+            fprintf(stderr, "  byte %d: posición %lld valor '%c'\n", i,
+                    (long long)salida[i].posicion, salida[i].valor);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Los fallos esperados imprimen su mensaje: ocultarlo mientras se prueban
+static int stderr_guardado = -1;
+
+static inline void silenciar(void) {
+    fflush(stderr);
+    stderr_guardado = dup(STDERR_FILENO);
+    int nulo = open("/dev/null", O_WRONLY);
+    dup2(nulo, STDERR_FILENO);
+    close(nulo);
+}
+
+static inline void restaurar(void) {
+    fflush(stderr);
+    dup2(stderr_guardado, STDERR_FILENO);
+    close(stderr_guardado);
+}
+
+// Activar la finalización como lo hace despertar_procesos: bandera y época de cierre
+static inline void activar_finalizar(canal_t *c) {
+    shared_mem_t *shm = canal_segmento(c);
+    __atomic_store_n(canal_bandera_finalizar(c), 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&shm->epoca_cierre, 1, __ATOMIC_SEQ_CST);
+    futex_despertar(&shm->epoca_cierre);
+}
+
+static inline int terminar_prueba(const char *prueba) {
+    if (pruebas_fallidas) {
+        printf("%s: %d fallos\n", prueba, pruebas_fallidas);
+        return 1;
+    }
+    printf("%s: ok\n", prueba);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,134 @@
+// prueba_abrir.c - canal_abrir: papeles, registro, carriles y cabeceras incompatibles
+#include "prueba.h"
+
+static void abrir_papeles(int modo) {
+    const char *nombre = nombre_prueba("abrir");
+    canal_t *c = crear_prueba(nombre, modo, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    shared_mem_t *shm = canal_segmento(c);
+
+    // Un observador no se registra
+    canal_t *obs = canal_abrir(nombre, CANAL_OBSERVADOR, NULL);
+    VERIFICAR(obs != NULL);
+    VERIFICAR_IGUAL(procesos_registrados(shm), 0);
+
+    // Cada registro es el de su propio proceso, también el de un segundo
+    // receptor (en difusión se registra por otro camino)
+    espera_t spin = { ESPERA_SPIN, 0 };
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, &spin);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    canal_t *rec2 = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL && rec2 != NULL);
+    VERIFICAR_IGUAL(shm->emisores_activos, 1);
+    VERIFICAR_IGUAL(shm->receptores_activos, 2);
+    VERIFICAR_IGUAL(procesos_registrados(shm), 3);
+    for (int i = 0; i < procesos_registrados(shm); i++) {
+        proceso_t *p = &shm->procesos[i];
+        VERIFICAR_IGUAL(p->pid, getpid());
+        VERIFICAR_IGUAL(p->activo, PROCESO_ACTIVO);
+        VERIFICAR_IGUAL(p->principal, i);
+        VERIFICAR_IGUAL(p->hilos, 1);
+    }
+
+    // Todos ven la misma configuración
+    canal_info_t info;
+    canal_info(emi, &info);
+    VERIFICAR_IGUAL(info.modo_anillo, modo);
+    VERIFICAR_IGUAL(info.capacidad, 1024);
+    VERIFICAR_IGUAL(info.carril, 0);
+    VERIFICAR_IGUAL(info.registro_max, modo == CANAL_REGISTROS ? registro_max(shm) : 0);
+
+    canal_cerrar(rec2);
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_cerrar(obs);
+    canal_destruir(c);
+}
+
+// Con varios carriles cada emisor y cada receptor toma el siguiente
+static void abrir_carriles(void) {
+    canal_config_t cfg;
+    canal_config_defecto(&cfg);
+    cfg.modo_anillo = CANAL_LOCKFREE;
+    cfg.carriles = 4;
+    const char *nombre = nombre_prueba("abrir");
+    canal_t *c = canal_crear(nombre, &cfg);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+
+    canal_t *emisores[4];
+    for (int i = 0; i < 4; i++) {
+        emisores[i] = canal_abrir(nombre, CANAL_EMISOR, NULL);
+        VERIFICAR(emisores[i] != NULL);
+        canal_info_t info;
+        canal_info(emisores[i], &info);
+        VERIFICAR_IGUAL(info.carril, i);
+    }
+    for (int i = 0; i < 4; i++) {
+        canal_cerrar(emisores[i]);
+    }
+    canal_destruir(c);
+}
+
+// Un segmento inexistente o con cabecera incompatible no se adjunta
+static void abrir_invalido(void) {
+    silenciar();
+    canal_t *c = canal_abrir("/prueba_no_existe", CANAL_EMISOR, NULL);
+    restaurar();
+    VERIFICAR(c == NULL);
+
+    const char *nombre = nombre_prueba("abrir");
+    canal_t *creado = crear_prueba(nombre, CANAL_MUTEX, CANAL_AOS, 1024);
+    VERIFICAR(creado != NULL);
+    if (!creado) {
+        return;
+    }
+    cabecera_segmento_t *cabecera = &canal_segmento(creado)->cabecera;
+    cabecera_segmento_t original = *cabecera;
+
+    cabecera->magia = 0;
+    silenciar();
+    c = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    restaurar();
+    VERIFICAR(c == NULL);
+    *cabecera = original;
+
+    cabecera->version = SEGMENTO_VERSION + 1;
+    silenciar();
+    c = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    restaurar();
+    VERIFICAR(c == NULL);
+    *cabecera = original;
+
+    cabecera->caracteristicas |= ~CARACT_CONOCIDAS;
+    silenciar();
+    c = canal_abrir(nombre, CANAL_OBSERVADOR, NULL);
+    restaurar();
+    VERIFICAR(c == NULL);
+    *cabecera = original;
+
+    // Un intento fallido no deja registros ni contadores
+    VERIFICAR_IGUAL(procesos_registrados(canal_segmento(creado)), 0);
+    VERIFICAR_IGUAL(canal_segmento(creado)->receptores_activos, 0);
+
+    c = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    VERIFICAR(c != NULL);
+    if (c) {
+        canal_cerrar(c);
+    }
+    canal_destruir(creado);
+}
+
+int main(void) {
+    for (int m = 0; m < N_MODOS_PRUEBA; m++) {
+        abrir_papeles(modos_prueba[m]);
+    }
+    abrir_carriles();
+    abrir_invalido();
+    return terminar_prueba("canal_abrir");
+}
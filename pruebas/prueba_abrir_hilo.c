@@ -0,0 +1,157 @@
+// prueba_abrir_hilo.c - canal_abrir_hilo: mapeo compartido, carril y registro propios
+#include "prueba.h"
+
+static canal_dato_t salida[1024];
+static char datos[1024];
+
+static void hilo_emisor(int modo) {
+    const char *nombre = nombre_prueba("hilo");
+    canal_t *c = crear_prueba(nombre, modo, CANAL_AOS, 4096);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    shared_mem_t *shm = canal_segmento(c);
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+
+    // El hilo comparte el mapeo y tiene su propio registro, ligado al del proceso
+    canal_t *hilo = canal_abrir_hilo(emi);
+    VERIFICAR(hilo != NULL);
+    if (!hilo) {
+        return;
+    }
+    VERIFICAR(canal_segmento(hilo) == canal_segmento(emi));
+    VERIFICAR_IGUAL(procesos_registrados(shm), 3);
+    proceso_t *p_emi = &shm->procesos[1];
+    proceso_t *p_hilo = &shm->procesos[2];
+    VERIFICAR_IGUAL(p_hilo->tipo, PROCESO_EMISOR);
+    VERIFICAR_IGUAL(p_hilo->principal, 1);
+    VERIFICAR_IGUAL(p_emi->principal, 1);
+    VERIFICAR_IGUAL(p_hilo->activo, PROCESO_ACTIVO);
+    VERIFICAR_IGUAL(p_emi->hilos, 2);
+
+    // Lo que publica cada conexión llega con sus offsets
+    llenar_prueba(datos, 300, 0);
+    VERIFICAR_IGUAL(canal_enviar(hilo, datos, 100, 0), 100);
+    VERIFICAR_IGUAL(canal_enviar(emi, datos + 100, 200, 100), 200);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 300, 1024), 300);
+    VERIFICAR(tramo_correcto(salida, 300, 0));
+
+    // Los contadores de ambos hilos se suman en el registro del proceso
+    VERIFICAR_IGUAL(p_emi->bytes, 300);
+    VERIFICAR_IGUAL(p_hilo->bytes, 0);
+    VERIFICAR_IGUAL(p_hilo->lotes, 0);
+    VERIFICAR_IGUAL(total_procesos(shm, PROCESO_EMISOR), 300);
+
+    // Cerrar el hilo no desmapea: la conexión base sigue funcionando
+    canal_cerrar(hilo);
+    VERIFICAR_IGUAL(p_hilo->activo, PROCESO_TERMINADO);
+    llenar_prueba(datos, 50, 300);
+    VERIFICAR_IGUAL(canal_enviar(emi, datos, 50, 300), 50);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 50, 1024), 50);
+    VERIFICAR(tramo_correcto(salida, 50, 300));
+
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+// Hilos receptores: cada uno toma del carril propio o roba de los demás
+static void hilo_receptor(int modo) {
+    canal_config_t cfg;
+    canal_config_defecto(&cfg);
+    cfg.modo_anillo = modo;
+    cfg.capacidad = 4096;
+    cfg.carriles = modo == CANAL_REGISTROS ? 1 : 2;
+    const char *nombre = nombre_prueba("hilo");
+    canal_t *c = canal_crear(nombre, &cfg);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *hilo = rec ? canal_abrir_hilo(rec) : NULL;
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && hilo != NULL && emi != NULL);
+    if (!hilo) {
+        return;
+    }
+    canal_info_t info;
+    canal_info(hilo, &info);
+    VERIFICAR_IGUAL(info.carril, cfg.carriles - 1);
+
+    // Entre las dos conexiones se recibe todo, sin duplicados. En registros
+    // cada conexión guarda lo que no entregó de su último registro, así que
+    // se lee de a un registro entero
+    llenar_prueba(datos, 200, 0);
+    for (int i = 0; i < 200; i += 20) {
+        VERIFICAR_IGUAL(canal_enviar_lote(emi, datos + i, 20, i), 20);
+    }
+    int vistos[200] = { 0 };
+    int total = 0;
+    for (int i = 0; i < 2 && total < 200; i++) {
+        int n = canal_recibir_lote(hilo, salida, 20);
+        for (int k = 0; k < n; k++) {
+            vistos[salida[k].posicion]++;
+        }
+        total += n > 0 ? n : 0;
+    }
+    while (total < 200) {
+        int n = canal_recibir_lote(rec, salida, 20);
+        VERIFICAR(n > 0);
+        if (n <= 0) {
+            break;
+        }
+        for (int k = 0; k < n; k++) {
+            vistos[salida[k].posicion]++;
+        }
+        total += n;
+    }
+    for (int i = 0; i < 200; i++) {
+        VERIFICAR_IGUAL(vistos[i], 1);
+    }
+    shared_mem_t *shm = canal_segmento(c);
+    VERIFICAR_IGUAL(shm->procesos[0].bytes, 200);
+    VERIFICAR_IGUAL(shm->procesos[0].hilos, 2);
+    VERIFICAR_IGUAL(shm->procesos[1].bytes, 0);
+
+    canal_cerrar(hilo);
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+// Observadores y receptores de difusión no tienen hilos de trabajo
+static void hilo_invalido(void) {
+    const char *nombre = nombre_prueba("hilo");
+    canal_t *c = crear_prueba(nombre, CANAL_DIFUSION, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    VERIFICAR(rec != NULL);
+    silenciar();
+    canal_t *h_obs = canal_abrir_hilo(c);
+    canal_t *h_rec = rec ? canal_abrir_hilo(rec) : NULL;
+    restaurar();
+    VERIFICAR(h_obs == NULL);
+    VERIFICAR(h_rec == NULL);
+    VERIFICAR_IGUAL(procesos_registrados(canal_segmento(c)), 1);
+
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+int main(void) {
+    for (int m = 0; m < N_MODOS_PRUEBA; m++) {
+        hilo_emisor(modos_prueba[m]);
+        if (modos_prueba[m] != CANAL_DIFUSION) {
+            hilo_receptor(modos_prueba[m]);
+        }
+    }
+    hilo_invalido();
+    return terminar_prueba("canal_abrir_hilo");
+}
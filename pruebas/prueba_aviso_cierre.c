@@ -0,0 +1,73 @@
+// prueba_aviso_cierre.c - canal_aviso_cierre: el descriptor se vuelve legible al finalizar
+#include "prueba.h"
+#include <poll.h>
+
+static int legible(int fd, int timeout_ms) {
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    return poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & POLLIN);
+}
+
+static void aviso_modo(int modo) {
+    const char *nombre = nombre_prueba("aviso");
+    canal_t *c = crear_prueba(nombre, modo, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(emi != NULL);
+    if (!emi) {
+        canal_destruir(c);
+        return;
+    }
+
+    int fd = canal_aviso_cierre(emi);
+    VERIFICAR(fd >= 0);
+    VERIFICAR_IGUAL(canal_aviso_cierre(emi), fd);  // Uno por conexión
+    canal_t *hilo = canal_abrir_hilo(emi);
+    VERIFICAR(hilo != NULL);
+    if (hilo) {
+        VERIFICAR_IGUAL(canal_aviso_cierre(hilo), fd);  // Los hilos usan el de su base
+    }
+
+    // Sin finalización no se marca, aunque la época suba
+    __atomic_fetch_add(&canal_segmento(c)->epoca_cierre, 1, __ATOMIC_SEQ_CST);
+    futex_despertar(&canal_segmento(c)->epoca_cierre);
+    VERIFICAR(!legible(fd, 20));
+
+    activar_finalizar(c);
+    VERIFICAR(legible(fd, 2000));
+    VERIFICAR(legible(fd, 0));  // Sigue legible para todos los que esperen
+
+    if (hilo) {
+        canal_cerrar(hilo);
+    }
+    canal_cerrar(emi);
+    canal_destruir(c);
+}
+
+// Cerrar la conexión sin finalizar detiene al vigía (la prueba no debe colgarse)
+static void aviso_sin_cierre(void) {
+    const char *nombre = nombre_prueba("aviso");
+    canal_t *c = crear_prueba(nombre, CANAL_MUTEX, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    VERIFICAR(rec != NULL);
+    if (rec) {
+        VERIFICAR(canal_aviso_cierre(rec) >= 0);
+        canal_cerrar(rec);
+    }
+    VERIFICAR(canal_aviso_cierre(c) >= 0);  // También para observadores
+    VERIFICAR_IGUAL(canal_destruir(c), 0);
+}
+
+int main(void) {
+    for (int m = 0; m < N_MODOS_PRUEBA; m++) {
+        aviso_modo(modos_prueba[m]);
+    }
+    aviso_sin_cierre();
+    return terminar_prueba("canal_aviso_cierre");
+}
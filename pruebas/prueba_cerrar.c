@@ -0,0 +1,86 @@
+// prueba_cerrar.c - canal_cerrar: contadores, registro y suscripción de difusión
+#include "prueba.h"
+
+static canal_dato_t salida[2048];
+static char datos[2048];
+
+static void cerrar_papeles(int modo) {
+    const char *nombre = nombre_prueba("cerrar");
+    canal_t *c = crear_prueba(nombre, modo, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    shared_mem_t *shm = canal_segmento(c);
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+
+    llenar_prueba(datos, 40, 0);
+    VERIFICAR_IGUAL(canal_enviar(emi, datos, 40, 0), 40);
+    canal_cerrar(emi);
+    VERIFICAR_IGUAL(shm->emisores_activos, 0);
+    VERIFICAR_IGUAL(shm->receptores_activos, 1);
+    VERIFICAR_IGUAL(shm->procesos[1].activo, PROCESO_TERMINADO);
+    VERIFICAR_IGUAL(shm->procesos[1].fase, FASE_LIBRE);
+
+    // Lo que publicó un emisor que ya cerró sigue en el anillo
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 40, 64), 40);
+    VERIFICAR(tramo_correcto(salida, 40, 0));
+
+    canal_cerrar(rec);
+    VERIFICAR_IGUAL(shm->receptores_activos, 0);
+    VERIFICAR_IGUAL(shm->procesos[0].activo, PROCESO_TERMINADO);
+
+    // Los registros se conservan para las estadísticas finales
+    VERIFICAR_IGUAL(procesos_registrados(shm), 2);
+    VERIFICAR_IGUAL(shm->procesos[1].bytes, 40);
+    VERIFICAR_IGUAL(shm->procesos[0].bytes, 40);
+
+    // Cerrar un observador no toca los contadores
+    canal_t *obs = canal_abrir(nombre, CANAL_OBSERVADOR, NULL);
+    VERIFICAR(obs != NULL);
+    canal_cerrar(obs);
+    VERIFICAR_IGUAL(shm->emisores_activos, 0);
+    VERIFICAR_IGUAL(shm->receptores_activos, 0);
+
+    canal_destruir(c);
+}
+
+// En difusión un receptor que cierra deja de frenar a los emisores
+static void cerrar_difusion(void) {
+    const char *nombre = nombre_prueba("cerrar");
+    canal_t *c = crear_prueba(nombre, CANAL_DIFUSION, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *lento = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(lento != NULL && rec != NULL && emi != NULL);
+
+    llenar_prueba(datos, 1024, 0);
+    VERIFICAR_IGUAL(canal_enviar(emi, datos, 1024, 0), 1024);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 1024, 1024), 1024);
+    VERIFICAR(canal_ocupacion(emi) == 1);  // El lento no leyó nada: anillo lleno
+
+    canal_cerrar(lento);
+    VERIFICAR(canal_ocupacion(emi) == 0);
+    llenar_prueba(datos, 1024, 1024);
+    VERIFICAR_IGUAL(canal_enviar(emi, datos, 1024, 1024), 1024);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 1024, 1024), 1024);
+    VERIFICAR(tramo_correcto(salida, 1024, 1024));
+
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+int main(void) {
+    for (int m = 0; m < N_MODOS_PRUEBA; m++) {
+        cerrar_papeles(modos_prueba[m]);
+    }
+    cerrar_difusion();
+    return terminar_prueba("canal_cerrar");
+}
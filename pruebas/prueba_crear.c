@@ -0,0 +1,129 @@
+// prueba_crear.c - canal_crear: geometría, cabecera y configuraciones inválidas
+#include "prueba.h"
+
+static void crear_valido(int modo, int layout) {
+    const char *nombre = nombre_prueba("crear");
+    canal_t *c = crear_prueba(nombre, modo, layout, 1000);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+
+    canal_info_t info;
+    canal_info(c, &info);
+    VERIFICAR_IGUAL(info.modo_anillo, modo);
+    VERIFICAR_IGUAL(info.layout, layout);
+    VERIFICAR_IGUAL(info.capacidad, 1024);   // Redondeada a potencia de dos
+    VERIFICAR_IGUAL(info.carriles, 1);
+    VERIFICAR(info.tamano_segmento >= sizeof(shared_mem_t));
+
+    // La cabecera queda publicada y el segmento vacío
+    shared_mem_t *shm = canal_segmento(c);
+    VERIFICAR_IGUAL(shm->cabecera.magia, SEGMENTO_MAGIA);
+    VERIFICAR_IGUAL(shm->cabecera.version, SEGMENTO_VERSION);
+    VERIFICAR_IGUAL(shm->cabecera.tamano_total, info.tamano_segmento);
+    VERIFICAR_IGUAL(chars_en_anillo(shm), 0);
+    VERIFICAR_IGUAL(shm->emisores_activos, 0);
+    VERIFICAR_IGUAL(shm->receptores_activos, 0);
+
+    // Crear de nuevo con el mismo nombre reemplaza el segmento
+    canal_t *otro = crear_prueba(nombre, modo, layout, 64 * 1024);
+    VERIFICAR(otro != NULL);
+    if (otro) {
+        canal_info(otro, &info);
+        VERIFICAR_IGUAL(info.capacidad, 64 * 1024);
+        canal_cerrar(c);
+        c = otro;
+    }
+    VERIFICAR_IGUAL(canal_destruir(c), 0);
+}
+
+static void crear_carriles(void) {
+    canal_config_t cfg;
+    canal_config_defecto(&cfg);
+    cfg.modo_anillo = CANAL_LOCKFREE;
+    cfg.capacidad = 1024;
+    cfg.carriles = 3;
+    canal_t *c = canal_crear(nombre_prueba("crear"), &cfg);
+    VERIFICAR(c != NULL);
+    if (c) {
+        canal_info_t info;
+        canal_info(c, &info);
+        VERIFICAR_IGUAL(info.carriles, 4);
+        VERIFICAR_IGUAL(canal_segmento(c)->carril_size, 256);
+        canal_destruir(c);
+    }
+}
+
+// Cada configuración inválida devuelve NULL y no deja segmento
+static void crear_invalido(const char *que, canal_config_t *cfg) {
+    const char *nombre = nombre_prueba("crear");
+    silenciar();
+    errno = 0;
+    canal_t *c = canal_crear(nombre, cfg);
+    int error = errno;
+    canal_t *abierto = canal_abrir(nombre, CANAL_OBSERVADOR, NULL);
+    restaurar();
+    if (c || abierto) {
+        fprintf(stderr, "crear_invalido: se aceptó %s\n", que);
+        pruebas_fallidas++;
+    } else if (error != EINVAL) {
+        fprintf(stderr, "crear_invalido: %s no dejó errno = EINVAL (%d)\n", que, error);
+        pruebas_fallidas++;
+    }
+    if (abierto) {
+        canal_cerrar(abierto);
+    }
+    if (c) {
+        canal_destruir(c);
+    }
+}
+
+static void crear_invalidos(void) {
+    canal_config_t cfg;
+
+    canal_config_defecto(&cfg);
+    cfg.capacidad = 0;
+    crear_invalido("capacidad 0", &cfg);
+
+    canal_config_defecto(&cfg);
+    cfg.capacidad = (long)BUFFER_MAX + 1;
+    crear_invalido("capacidad sobre BUFFER_MAX", &cfg);
+
+    canal_config_defecto(&cfg);
+    cfg.carriles = 0;
+    crear_invalido("0 carriles", &cfg);
+
+    canal_config_defecto(&cfg);
+    cfg.capacidad = 4;
+    cfg.carriles = 8;
+    crear_invalido("más carriles que slots", &cfg);
+
+    canal_config_defecto(&cfg);
+    cfg.modo_anillo = CANAL_DIFUSION;
+    cfg.carriles = 2;
+    crear_invalido("difusión con dos carriles", &cfg);
+
+    canal_config_defecto(&cfg);
+    cfg.modo_anillo = CANAL_REGISTROS;
+    cfg.capacidad = REGISTROS_MIN_BUFFER / 2;
+    crear_invalido("registros bajo el mínimo", &cfg);
+
+    canal_config_defecto(&cfg);
+    cfg.nodo_numa = 8 * (long)sizeof(unsigned long);
+    crear_invalido("nodo NUMA fuera de la máscara", &cfg);
+    cfg.nodo_numa = -5;
+    crear_invalido("nodo NUMA negativo distinto de -1", &cfg);
+}
+
+int main(void) {
+    for (int m = 0; m < N_MODOS_PRUEBA; m++) {
+        crear_valido(modos_prueba[m], CANAL_AOS);
+        if (modos_prueba[m] != CANAL_REGISTROS) {
+            crear_valido(modos_prueba[m], CANAL_SOA);
+        }
+    }
+    crear_carriles();
+    crear_invalidos();
+    return terminar_prueba("canal_crear");
+}
@@ -0,0 +1,71 @@
+// prueba_destruir.c - canal_destruir: el segmento desaparece y el nombre se puede reutilizar
+#include "prueba.h"
+#include <sys/stat.h>
+
+static int existe_segmento(const char *nombre) {
+    char ruta[128];
+    struct stat st;
+    snprintf(ruta, sizeof(ruta), "/dev/shm%s", nombre);
+    return stat(ruta, &st) == 0;
+}
+
+static void destruir_modo(int modo) {
+    const char *nombre = nombre_prueba("destruir");
+    canal_t *c = crear_prueba(nombre, modo, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    VERIFICAR(existe_segmento(nombre));
+
+    // Usado y cerrado por emisor y receptor antes de destruir
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+    char datos[16];
+    canal_dato_t salida[16];
+    llenar_prueba(datos, 16, 0);
+    VERIFICAR_IGUAL(canal_enviar(emi, datos, 16, 0), 16);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 16, 16), 16);
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+
+    VERIFICAR_IGUAL(canal_destruir(c), 0);
+    VERIFICAR(!existe_segmento(nombre));
+
+    silenciar();
+    canal_t *tarde = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    restaurar();
+    VERIFICAR(tarde == NULL);
+
+    // El nombre queda libre para un canal nuevo
+    c = crear_prueba(nombre, modo, CANAL_AOS, 2048);
+    VERIFICAR(c != NULL);
+    if (c) {
+        VERIFICAR_IGUAL(canal_destruir(c), 0);
+    }
+}
+
+// Destruir un segmento que alguien más ya eliminó informa el error
+static void destruir_eliminado(void) {
+    const char *nombre = nombre_prueba("destruir");
+    canal_t *c = crear_prueba(nombre, CANAL_MUTEX, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *otro = canal_abrir(nombre, CANAL_OBSERVADOR, NULL);
+    VERIFICAR(otro != NULL);
+    VERIFICAR_IGUAL(canal_destruir(otro), 0);
+    silenciar();
+    VERIFICAR_IGUAL(canal_destruir(c), -1);
+    restaurar();
+}
+
+int main(void) {
+    for (int m = 0; m < N_MODOS_PRUEBA; m++) {
+        destruir_modo(modos_prueba[m]);
+    }
+    destruir_eliminado();
+    return terminar_prueba("canal_destruir");
+}
@@ -0,0 +1,104 @@
+// prueba_enviar.c - canal_enviar y canal_enviar_lote: bytes, offsets, límites y finalización
+#include "prueba.h"
+
+#define CAPACIDAD 16384
+
+static canal_dato_t salida[CAPACIDAD];
+static char datos[CAPACIDAD];
+
+static void enviar_lotes(int modo, int layout) {
+    const char *nombre = nombre_prueba("enviar");
+    canal_t *c = crear_prueba(nombre, modo, layout, CAPACIDAD);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+
+    // Un lote se publica entero y llega en orden con sus offsets
+    llenar_prueba(datos, 100, 0);
+    VERIFICAR_IGUAL(canal_enviar_lote(emi, datos, 100, 0), 100);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 100, CANAL_LOTE_MAX), 100);
+    VERIFICAR(tramo_correcto(salida, 100, 0));
+
+    // Offsets arbitrarios, más allá de 4 GiB
+    int64_t lejos = (int64_t)5 << 30;
+    llenar_prueba(datos, 10, lejos);
+    VERIFICAR_IGUAL(canal_enviar_lote(emi, datos, 10, lejos), 10);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 10, CANAL_LOTE_MAX), 10);
+    VERIFICAR(tramo_correcto(salida, 10, lejos));
+
+    // Un lote mayor que el máximo se recorta (y en registros, a un registro)
+    int tope = modo == CANAL_REGISTROS ? registro_max(canal_segmento(c)) : CANAL_LOTE_MAX;
+    llenar_prueba(datos, CANAL_LOTE_MAX + 100, 200);
+    int enviados = canal_enviar_lote(emi, datos, CANAL_LOTE_MAX + 100, 200);
+    VERIFICAR_IGUAL(enviados, tope);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, enviados, CANAL_LOTE_MAX), enviados);
+    VERIFICAR(tramo_correcto(salida, enviados, 200));
+
+    // canal_enviar publica todo, en tantos lotes como haga falta
+    int n = 3 * CANAL_LOTE_MAX / 2;
+    llenar_prueba(datos, n, 1000);
+    VERIFICAR_IGUAL(canal_enviar(emi, datos, n, 1000), n);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, n, CANAL_LOTE_MAX), n);
+    VERIFICAR(tramo_correcto(salida, n, 1000));
+
+    // Muchas vueltas al anillo con lotes de tamaño variable
+    int64_t posicion = 0;
+    for (int vuelta = 0; vuelta < 200; vuelta++) {
+        int len = 1 + (vuelta * 37) % 500;
+        llenar_prueba(datos, len, posicion);
+        VERIFICAR_IGUAL(canal_enviar(emi, datos, len, posicion), len);
+        VERIFICAR_IGUAL(recibir_todo(rec, salida, len, 64), len);
+        VERIFICAR(tramo_correcto(salida, len, posicion));
+        posicion += len;
+    }
+
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+/*
+ * Con finalizar activo un emisor no se bloquea: publica mientras hay
+ * espacio y en cuanto tendría que esperar devuelve -1.
+ */
+static void enviar_finalizando(int modo) {
+    const char *nombre = nombre_prueba("enviar");
+    canal_t *c = crear_prueba(nombre, modo, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+
+    activar_finalizar(c);
+    llenar_prueba(datos, 64, 0);
+    int total = 0, r = 0;
+    for (int i = 0; i < 1024 && (r = canal_enviar_lote(emi, datos, 64, total)) > 0; i++) {
+        total += r;
+    }
+    VERIFICAR_IGUAL(r, -1);
+    VERIFICAR(total <= 1024);
+    VERIFICAR(total >= (modo == CANAL_REGISTROS ? 512 : 1024));
+    VERIFICAR_IGUAL(canal_enviar(emi, datos, 64, total), -1);
+
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+int main(void) {
+    for (int m = 0; m < N_MODOS_PRUEBA; m++) {
+        enviar_lotes(modos_prueba[m], CANAL_AOS);
+        if (modos_prueba[m] != CANAL_REGISTROS) {
+            enviar_lotes(modos_prueba[m], CANAL_SOA);
+        }
+        enviar_finalizando(modos_prueba[m]);
+    }
+    return terminar_prueba("canal_enviar");
+}
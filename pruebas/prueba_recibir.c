@@ -0,0 +1,133 @@
+// prueba_recibir.c - canal_recibir y canal_recibir_lote: drenado, cortes, difusión y finalización
+#include "prueba.h"
+
+static canal_dato_t salida[4096];
+static char datos[4096];
+
+static void recibir_lotes(int modo, int layout) {
+    const char *nombre = nombre_prueba("recibir");
+    canal_t *c = crear_prueba(nombre, modo, layout, 4096);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+
+    // De a un byte
+    llenar_prueba(datos, 3, 40);
+    VERIFICAR_IGUAL(canal_enviar(emi, datos, 3, 40), 3);
+    for (int i = 0; i < 3; i++) {
+        canal_dato_t dato;
+        VERIFICAR_IGUAL(canal_recibir(rec, &dato), 1);
+        VERIFICAR(tramo_correcto(&dato, 1, 40 + i));
+    }
+
+    // Un lote nunca pasa de max; lo que sobra queda para la siguiente llamada
+    llenar_prueba(datos, 10, 0);
+    VERIFICAR_IGUAL(canal_enviar_lote(emi, datos, 10, 0), 10);
+    VERIFICAR_IGUAL(canal_recibir_lote(rec, salida, 4), 4);
+    VERIFICAR_IGUAL(canal_recibir_lote(rec, salida + 4, 4), 4);
+    VERIFICAR_IGUAL(canal_recibir_lote(rec, salida + 8, 4), 2);
+    VERIFICAR(tramo_correcto(salida, 10, 0));
+
+    // Varios lotes publicados se drenan juntos salvo en registros (uno por registro)
+    llenar_prueba(datos, 30, 100);
+    VERIFICAR_IGUAL(canal_enviar_lote(emi, datos, 10, 100), 10);
+    VERIFICAR_IGUAL(canal_enviar_lote(emi, datos + 10, 20, 110), 20);
+    int n = canal_recibir_lote(rec, salida, 64);
+    VERIFICAR_IGUAL(n, modo == CANAL_REGISTROS ? 10 : 30);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida + n, 30 - n, 64), 30 - n);
+    VERIFICAR(tramo_correcto(salida, 30, 100));
+
+    // La marca de publicación no es posterior a la recepción
+    uint64_t ahora = reloj_ns();
+    VERIFICAR(salida[0].marca_ns <= ahora);
+    canal_entregado(rec, salida, 30, ahora);
+
+    // Cada byte (en registros, cada registro tomado) entra una vez en los
+    // histogramas, aunque se vuelquen por tramos
+    shared_mem_t *shm = canal_segmento(c);
+    histograma_t h;
+    hist_sumar(&h, shm->residencia, MAX_HISTOGRAMAS);
+    VERIFICAR_IGUAL(h.total, modo == CANAL_REGISTROS ? 4 : 43);
+    VERIFICAR(h.max_ns >= h.suma_ns / h.total);
+    hist_sumar(&h, shm->extremo, MAX_HISTOGRAMAS);
+    VERIFICAR_IGUAL(h.total, 30);
+    VERIFICAR_IGUAL(h.max_ns, ahora - salida[0].marca_ns > ahora - salida[29].marca_ns
+                                  ? ahora - salida[0].marca_ns : ahora - salida[29].marca_ns);
+
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+// En difusión cada receptor recibe el flujo completo desde que se suscribió
+static void recibir_difusion(void) {
+    const char *nombre = nombre_prueba("recibir");
+    canal_t *c = crear_prueba(nombre, CANAL_DIFUSION, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *a = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *b = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(a != NULL && b != NULL && emi != NULL);
+
+    int64_t posicion = 0;
+    for (int vuelta = 0; vuelta < 20; vuelta++) {
+        llenar_prueba(datos, 500, posicion);
+        VERIFICAR_IGUAL(canal_enviar(emi, datos, 500, posicion), 500);
+        VERIFICAR_IGUAL(recibir_todo(a, salida, 500, 128), 500);
+        VERIFICAR(tramo_correcto(salida, 500, posicion));
+        VERIFICAR_IGUAL(recibir_todo(b, salida, 500, 500), 500);
+        VERIFICAR(tramo_correcto(salida, 500, posicion));
+        posicion += 500;
+    }
+
+    canal_cerrar(emi);
+    canal_cerrar(b);
+    canal_cerrar(a);
+    canal_destruir(c);
+}
+
+// Con el anillo vacío y finalizar activo la recepción devuelve -1 sin bloquearse
+static void recibir_finalizando(int modo) {
+    const char *nombre = nombre_prueba("recibir");
+    canal_t *c = crear_prueba(nombre, modo, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+
+    // Lo publicado antes de finalizar todavía se entrega
+    llenar_prueba(datos, 8, 0);
+    VERIFICAR_IGUAL(canal_enviar_lote(emi, datos, 8, 0), 8);
+    activar_finalizar(c);
+    VERIFICAR_IGUAL(recibir_todo(rec, salida, 8, 64), 8);
+    VERIFICAR(tramo_correcto(salida, 8, 0));
+
+    VERIFICAR_IGUAL(canal_recibir_lote(rec, salida, 64), -1);
+    VERIFICAR_IGUAL(canal_recibir(rec, salida), -1);
+
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+int main(void) {
+    for (int m = 0; m < N_MODOS_PRUEBA; m++) {
+        recibir_lotes(modos_prueba[m], CANAL_AOS);
+        if (modos_prueba[m] != CANAL_REGISTROS) {
+            recibir_lotes(modos_prueba[m], CANAL_SOA);
+        }
+        recibir_finalizando(modos_prueba[m]);
+    }
+    recibir_difusion();
+    return terminar_prueba("canal_recibir");
+}
@@ -0,0 +1,165 @@
+// prueba_registros.c - canal_reservar, canal_confirmar, canal_tomar y canal_liberar (modo registros)
+#include "prueba.h"
+
+static void registros_uno(void) {
+    const char *nombre = nombre_prueba("registros");
+    canal_t *c = crear_prueba(nombre, CANAL_REGISTROS, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+    shared_mem_t *shm = canal_segmento(c);
+
+    // La carga útil se escribe en el lugar y se lee de la memoria compartida
+    // (cada conexión tiene su propio mapeo: se comparan offsets)
+    canal_registro_t r;
+    char *destino = canal_reservar(emi, 11, &r);
+    VERIFICAR(destino != NULL);
+    VERIFICAR_IGUAL(r.len, 11);
+    char *base_emi = (char *)canal_segmento(emi);
+    VERIFICAR(destino >= base_emi && destino + 11 <= base_emi + shm->cabecera.tamano_total);
+    llenar_prueba(destino, 11, 77);
+    canal_confirmar(emi, &r, 77);
+    VERIFICAR(canal_ocupacion(emi) > 0);
+
+    canal_registro_t leido;
+    const char *datos = canal_tomar(rec, &leido);
+    VERIFICAR(datos - (char *)canal_segmento(rec) == destino - base_emi);  // Mismo lugar, sin copias
+    VERIFICAR_IGUAL(leido.ticket, r.ticket);
+    VERIFICAR_IGUAL(leido.len, 11);
+    VERIFICAR_IGUAL(leido.posicion, 77);
+    VERIFICAR(leido.marca_ns != 0 && leido.marca_ns <= reloj_ns());
+    for (int i = 0; i < 11; i++) {
+        VERIFICAR_IGUAL(datos[i], byte_prueba(77 + i));
+    }
+    canal_liberar(rec, &leido);
+    canal_registro_entregado(rec, &leido, reloj_ns());
+    VERIFICAR(canal_ocupacion(emi) == 0);
+
+    // Registro de tamaño máximo
+    int max = registro_max(shm);
+    destino = canal_reservar(emi, max, &r);
+    VERIFICAR(destino != NULL);
+    llenar_prueba(destino, max, 0);
+    canal_confirmar(emi, &r, 0);
+    datos = canal_tomar(rec, &leido);
+    VERIFICAR(datos != NULL);
+    VERIFICAR_IGUAL(leido.len, max);
+    VERIFICAR(datos && memcmp(datos, destino, max) == 0);
+    canal_liberar(rec, &leido);
+
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+// Varios registros en vuelo y muchas vueltas: cada uno llega entero, en orden y con sus tickets
+static void registros_vueltas(void) {
+    const char *nombre = nombre_prueba("registros");
+    canal_t *c = crear_prueba(nombre, CANAL_REGISTROS, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+
+    int64_t enviado = 0, leido_hasta = 0;
+    int ticket_previo = -1;
+    for (int vuelta = 0; vuelta < 500; vuelta++) {
+        // Tres registros en vuelo (caben: cada uno ocupa a lo sumo 128 bytes)
+        int lens[3];
+        for (int k = 0; k < 3; k++) {
+            canal_registro_t r;
+            lens[k] = 1 + (vuelta * 7 + k * 31) % 100;
+            char *destino = canal_reservar(emi, lens[k], &r);
+            VERIFICAR(destino != NULL);
+            if (!destino) {
+                goto fin;
+            }
+            llenar_prueba(destino, lens[k], enviado);
+            canal_confirmar(emi, &r, enviado);
+            enviado += lens[k];
+        }
+        for (int k = 0; k < 3; k++) {
+            canal_registro_t r;
+            const char *datos = canal_tomar(rec, &r);
+            VERIFICAR(datos != NULL);
+            if (!datos) {
+                goto fin;
+            }
+            VERIFICAR_IGUAL(r.len, lens[k]);
+            VERIFICAR_IGUAL(r.posicion, leido_hasta);
+            VERIFICAR(r.ticket - ticket_previo > 0);
+            ticket_previo = r.ticket;
+            for (int i = 0; i < r.len; i++) {
+                if (datos[i] != byte_prueba(leido_hasta + i)) {
+                    VERIFICAR_IGUAL(datos[i], byte_prueba(leido_hasta + i));
+                    break;
+                }
+            }
+            leido_hasta += r.len;
+            canal_liberar(rec, &r);
+        }
+    }
+    VERIFICAR_IGUAL(leido_hasta, enviado);
+    VERIFICAR(enviado > 1024 * 20);  // Dio muchas vueltas al anillo
+
+fin:
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+// Con finalizar activo: reservar en un anillo lleno y tomar en uno vacío devuelven NULL
+static void registros_finalizando(void) {
+    const char *nombre = nombre_prueba("registros");
+    canal_t *c = crear_prueba(nombre, CANAL_REGISTROS, CANAL_AOS, 1024);
+    VERIFICAR(c != NULL);
+    if (!c) {
+        return;
+    }
+    canal_t *rec = canal_abrir(nombre, CANAL_RECEPTOR, NULL);
+    canal_t *emi = canal_abrir(nombre, CANAL_EMISOR, NULL);
+    VERIFICAR(rec != NULL && emi != NULL);
+
+    activar_finalizar(c);
+    canal_registro_t r;
+    VERIFICAR(canal_tomar(rec, &r) == NULL);
+
+    int confirmados = 0;
+    char *destino;
+    while (confirmados < 64 && (destino = canal_reservar(emi, 100, &r)) != NULL) {
+        llenar_prueba(destino, 100, 100 * confirmados);
+        canal_confirmar(emi, &r, 100 * confirmados);
+        confirmados++;
+    }
+    VERIFICAR(confirmados >= 1024 / registro_tam(100) - 1 && confirmados <= 1024 / registro_tam(100));
+
+    // Lo confirmado se sigue entregando y después se agota
+    for (int k = 0; k < confirmados; k++) {
+        const char *datos = canal_tomar(rec, &r);
+        VERIFICAR(datos != NULL);
+        if (!datos) {
+            break;
+        }
+        VERIFICAR_IGUAL(r.posicion, 100 * k);
+        canal_liberar(rec, &r);
+    }
+    VERIFICAR(canal_tomar(rec, &r) == NULL);
+
+    canal_cerrar(emi);
+    canal_cerrar(rec);
+    canal_destruir(c);
+}
+
+int main(void) {
+    registros_uno();
+    registros_vueltas();
+    registros_finalizando();
+    return terminar_prueba("canal_registros");
+}
@@ -1,4 +1,5 @@
 // receptor.c (VERSIÓN COMPLETA CON MODOS)
+#define _GNU_SOURCE  // pthread_setaffinity_np (ver hilos.h)
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,7 +13,12 @@
 #include <errno.h>
 #include <termios.h>
 #include <sys/select.h>
-#include "memoria_compartida.h"
+#include "canal.h"
+#include "colores.h"
+#include "modo_ejecucion.h"
+#include "cifrado.h"
+#include "escritor_salida.h"
+#include "hilos.h"
 
 
 volatile sig_atomic_t keep_running = 1;
@@ -39,15 +45,29 @@ void enable_raw_mode() {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
 }
 
-int wait_for_keypress() {
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(STDIN_FILENO, &readfds);
-    
+int wait_for_keypress(const int *finalizar, int cierre_fd) {
     printf(COLOR_CYAN "  [Presione cualquier tecla para continuar...]" COLOR_RESET "\r");
     fflush(stdout);
     
-    int result = select(STDIN_FILENO + 1, &readfds, NULL, NULL, NULL);
+    // select() espera la tecla o el aviso de cierre del canal; sin aviso,
+    // espera en tramos cortos para notar la finalización
+    int result = 0;
+    while (result == 0 && !__atomic_load_n(finalizar, __ATOMIC_ACQUIRE)) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(STDIN_FILENO, &readfds);
+        if (cierre_fd >= 0) {
+            FD_SET(cierre_fd, &readfds);
+            result = select((cierre_fd > STDIN_FILENO ? cierre_fd : STDIN_FILENO) + 1,
+                            &readfds, NULL, NULL, NULL);
+            if (result > 0 && FD_ISSET(cierre_fd, &readfds)) {
+                return 0;
+            }
+        } else {
+            struct timeval tramo = { 0, TRAMO_SONDEO_US };
+            result = select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tramo);
+        }
+    }
     
     if (result > 0) {
         char c;
@@ -59,202 +79,415 @@ int wait_for_keypress() {
     return 0;
 }
 
-void wait_automatic(int interval_ms) {
-    usleep(interval_ms * 1000);
+// Lo que comparten los hilos de trabajo del receptor (solo lectura)
+typedef struct {
+    llave_t llave;
+    unsigned char *output;    // Salida mapeada (NULL con el hilo escritor)
+    int64_t output_size;
+    canal_info_t info;
+} receptor_t;
+
+// Un hilo de trabajo: su conexión al canal, su ritmo, su bitácora y su escritor
+typedef struct {
+    const receptor_t *receptor;
+    const hilos_t *hilos;
+    int indice;
+    canal_t *canal;
+    modo_ejecucion_t modo;
+    bitacora_t *bitacora;
+    escritor_t *escritor;
+    long long char_count;
+    pthread_t hilo;
+} trabajador_t;
+
+// Ciclo principal de un hilo: recibir, descifrar y escribir en la salida
+static void *trabajar(void *arg) {
+    trabajador_t *t = arg;
+    const receptor_t *r = t->receptor;
+    unsigned char *output = r->output;
+    int64_t output_size = r->output_size;
+    canal_t *canal = t->canal;
+    modo_ejecucion_t *modo = &t->modo;
+    bitacora_t *bitacora = t->bitacora;
+    escritor_t *escritor = t->escritor;
+    canal_dato_t lote[MAX_LOTE];
+    unsigned char decrypted[MAX_LOTE];
+
+    fijar_afinidad(t->hilos, t->indice);
+
+    while (keep_running) {
+        canal_latir(canal);
+
+        // Verificar flag de finalización
+        int debe_finalizar = canal_finalizando(canal);
+        
+        if (debe_finalizar) {
+            printf("\n" COLOR_YELLOW "Receptor: Señal de finalización recibida\n" COLOR_RESET);
+            break;
+        }
+
+        // MODO DE EJECUCIÓN: Esperar según el modo
+        int cuota = modo->lote;
+        if (modo->tipo == MODO_MANUAL) {
+            if (!wait_for_keypress(modo->finalizar, modo->cierre_fd)) {
+                break;
+            }
+        } else {
+            if (toca_regular(modo)) {
+                regular_tasa(modo, canal_ocupacion(canal));
+            }
+            if ((cuota = esperar_turno(modo)) == 0) {
+                continue;  // Pausa cortada por la finalización
+            }
+        }
+
+        if (r->info.modo_anillo == CANAL_REGISTROS) {
+            // Un registro por ciclo, descifrado desde el anillo directo a la salida
+            canal_registro_t registro;
+            const char *datos = canal_tomar(canal, &registro);
+            if (!datos) {
+                break;
+            }
+
+            const unsigned char *claro = NULL;
+            if (registro.posicion >= 0 && registro.posicion + registro.len <= output_size) {
+                if (escritor) {
+                    cifrar(decrypted, (const unsigned char *)datos, registro.len, &r->llave,
+                           registro.posicion);
+                    for (int i = 0; i < registro.len; i++) {
+                        escritor_agregar(escritor, registro.posicion + i, decrypted[i]);
+                    }
+                    escritor_enviar(escritor);
+                    claro = decrypted;
+                } else {
+                    cifrar(output + registro.posicion, (const unsigned char *)datos, registro.len,
+                           &r->llave, registro.posicion);
+                    claro = output + registro.posicion;
+                }
+            }
+            uint64_t t_salida = reloj_ns();
+            canal_liberar(canal, &registro);
+            canal_registro_entregado(canal, &registro, t_salida);
+
+            if (claro && modo->bitacora == BITACORA_BYTES) {
+                for (int i = 0; i < registro.len; i++) {
+                    bitacora_agregar(bitacora, registro.posicion + i, claro[i],
+                                     t_salida - registro.marca_ns);
+                }
+            }
+            bitacora_enviar(bitacora, registro.len);
+
+            t->char_count += registro.len;
+            consumir_turno(modo, registro.len);
+            continue;
+        }
+
+        // Recibir lo disponible hasta la cuota (espera según la política si está vacío)
+        int disponibles = canal_recibir_lote(canal, lote, cuota);
+        if (disponibles < 0) {
+            break;
+        }
+
+        // Descifrar en el lugar por tramos de posiciones consecutivas (el
+        // flujo de la llave depende del offset en el archivo). Se descifra la
+        // copia del lote y no los slots: ya se liberaron al recibir y en
+        // DIFUSION los comparten todos los receptores.
+        for (int i = 0; i < disponibles; i++) {
+            decrypted[i] = (unsigned char)lote[i].valor;
+        }
+        for (int i = 0, j; i < disponibles; i = j) {
+            for (j = i + 1; j < disponibles && lote[j].posicion == lote[j - 1].posicion + 1; j++) {
+            }
+            cifrar(decrypted + i, decrypted + i, j - i, &r->llave, lote[i].posicion);
+        }
+        
+        // Escribir cada byte en su offset del archivo de salida
+        for (int i = 0; i < disponibles; i++) {
+            if (lote[i].posicion < 0 || lote[i].posicion >= output_size) {
+                continue;
+            }
+            if (escritor) {
+                escritor_agregar(escritor, lote[i].posicion, decrypted[i]);
+            } else {
+                output[lote[i].posicion] = decrypted[i];
+            }
+        }
+        if (escritor) {
+            escritor_enviar(escritor);
+        }
+        uint64_t t_salida = reloj_ns();
+
+        // Latencia extremo a extremo: de la publicación a la salida
+        canal_entregado(canal, lote, disponibles, t_salida);
+        
+        // Encolar los caracteres leídos para la consola
+        if (modo->bitacora == BITACORA_BYTES) {
+            for (int i = 0; i < disponibles; i++) {
+                if (lote[i].posicion < 0) {
+                    continue;  // Hueco de un emisor caído
+                }
+                bitacora_agregar(bitacora, lote[i].posicion, decrypted[i],
+                                 t_salida - lote[i].marca_ns);
+            }
+        }
+        bitacora_enviar(bitacora, disponibles);
+        
+        t->char_count += disponibles;
+        consumir_turno(modo, disponibles);
+    }
+    return NULL;
 }
 
 int main(int argc, char* argv[]){
     
-    if (argc != 4) {
-        fprintf(stderr, "Uso: %s <identificador_shm> <llave_desencriptacion> <modo>\n", argv[0]);
+    if (argc < 4) {
+        fprintf(stderr, "Uso: %s <identificador_shm> <llave_desencriptacion> <modo> [salida] [--threads=<n>] [--cpus=<lista>]\n", argv[0]);
         fprintf(stderr, "Modos:\n");
         fprintf(stderr, "  auto:<milisegundos>  - Modo automático (ej: auto:500)\n");
+        fprintf(stderr, "  max o auto:0         - Sin pausas, lo más rápido posible\n");
+        fprintf(stderr, "  rate:<bytes/s>       - Tasa fija con balde de fichas (ej: rate:500k)\n");
+        fprintf(stderr, "  adaptive[:<obj>%%]    - Tasa que sigue la ocupación del anillo (objetivo: %d%%)\n",
+                OBJETIVO_DEFECTO);
         fprintf(stderr, "  manual               - Modo manual (presionar tecla)\n");
+        fprintf(stderr, "  <modo>:batch=<n>     - Drenar hasta n caracteres disponibles por ciclo\n");
+        fprintf(stderr, "  <modo>:espera=<p>    - bloqueo (por defecto), spin o adaptativa[/<spins>]\n");
+        fprintf(stderr, "  <modo>:log=<nivel>   - bytes (por defecto), resumen[/<ms>] o silencio\n");
+        fprintf(stderr, "Llave: un byte (0-255) o varios en hexadecimal, ej: 0x2A7F10\n");
+        fprintf(stderr, "Salida:\n");
+        fprintf(stderr, "  mmap                 - Escribir directo en la salida mapeada (por defecto)\n");
+        fprintf(stderr, "  bytes:<n>            - Hilo escritor, vaciar cada n bytes acumulados\n");
+        fprintf(stderr, "  ms:<n>               - Hilo escritor, vaciar cada n milisegundos\n");
+        fprintf(stderr, "  cierre               - Hilo escritor, vaciar solo al finalizar\n");
+        fprintf(stderr, "Hilos:\n");
+        fprintf(stderr, "  --threads=<n>        - Ciclos de recepción en un proceso (máx. %d)\n", MAX_HILOS);
+        fprintf(stderr, "  --cpus=<lista>       - Fijar el hilo i a la i-ésima CPU (ej: 0,2-3)\n");
         fprintf(stderr, "\nEjemplos:\n");
-        fprintf(stderr, "  %s /mi_shm 42 auto:1000    # Leer cada 1 segundo\n", argv[0]);
-        fprintf(stderr, "  %s /mi_shm 42 manual       # Leer al presionar tecla\n", argv[0]);
+        fprintf(stderr, "  %s /mi_shm 42 auto:1000          # Leer cada 1 segundo\n", argv[0]);
+        fprintf(stderr, "  %s /mi_shm 42 auto:10:batch=256  # Leer todo lo disponible (hasta 256)\n", argv[0]);
+        fprintf(stderr, "  %s /mi_shm 42 manual             # Leer al presionar tecla\n", argv[0]);
+        fprintf(stderr, "  %s /mi_shm 42 auto:10 bytes:65536\n", argv[0]);
+        fprintf(stderr, "  %s /mi_shm 42 max --threads=4 --cpus=4-7\n", argv[0]);
         return 1;
     }
 
     const char *shm_name = argv[1];
-    unsigned char llave = (unsigned char)atoi(argv[2]);
-    char *modo_str = argv[3];
+    llave_t llave;
+    if (llave_parsear(argv[2], &llave) < 0) {
+        fprintf(stderr, "Error: Llave inválida. Use un byte (0-255) o '0x<hex>' (hasta %d bytes)\n",
+                MAX_LLAVE);
+        return 1;
+    }
+    char llave_str[2 * MAX_LLAVE + 32];
+    llave_describir(&llave, llave_str, sizeof(llave_str));
     
     // Parsear el modo de ejecución
-    int modo_automatico = 0;
-    int intervalo_ms = 1000;
-    
-    if (strncmp(modo_str, "auto:", 5) == 0) {
-        modo_automatico = 1;
-        intervalo_ms = atoi(modo_str + 5);
-        if (intervalo_ms <= 0) {
-            fprintf(stderr, "Error: Intervalo debe ser positivo\n");
+    modo_ejecucion_t modo;
+    if (parsear_modo(argv[3], &modo) < 0) {
+        return 1;
+    }
+    modo.sentido = SENTIDO_RECEPTOR;
+
+    // Política de salida (mmap directo o hilo escritor con vaciado diferido) y opciones de hilos
+    const char *salida_str = NULL;
+    hilos_t hilos;
+    hilos_defecto(&hilos);
+    for (int i = 4; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0) {
+            if (parsear_opcion_hilos(argv[i], &hilos) < 0) {
+                return 1;
+            }
+        } else if (!salida_str) {
+            salida_str = argv[i];
+        } else {
+            fprintf(stderr, "Error: Argumento de más '%s'\n", argv[i]);
             return 1;
         }
-    } else if (strcmp(modo_str, "manual") == 0) {
-        modo_automatico = 0;
-    } else {
-        fprintf(stderr, "Error: Modo inválido. Use 'auto:<ms>' o 'manual'\n");
+    }
+    if (modo.tipo == MODO_MANUAL && hilos.n > 1) {
+        fprintf(stderr, "Error: El modo manual usa un solo hilo\n");
         return 1;
     }
+
+    int usar_escritor = 0;
+    int politica_flush = FLUSH_CIERRE;
+    long umbral_flush = 0;
+    if (salida_str && strcmp(salida_str, "mmap") != 0) {
+        if (escritor_parsear(salida_str, &politica_flush, &umbral_flush) < 0) {
+            fprintf(stderr, "Error: Salida inválida. Use 'mmap', 'bytes:<n>', 'ms:<n>' o 'cierre'\n");
+            return 1;
+        }
+        usar_escritor = 1;
+    }
     
     printf("=== Receptor iniciado ===\n");
-    printf("Llave de desencriptación: 0x%02X\n", llave);
-    if (modo_automatico) {
-        printf("Modo: " COLOR_BLUE "AUTOMÁTICO" COLOR_RESET " (intervalo: %d ms)\n\n", intervalo_ms);
+    printf("Llave de desencriptación: %s\n", llave_str);
+    if (modo.tipo == MODO_AUTO) {
+        printf("Modo: " COLOR_BLUE "AUTOMÁTICO" COLOR_RESET " (intervalo: %d ms)\n", modo.intervalo_ms);
+    } else if (modo.tipo == MODO_MAX) {
+        printf("Modo: " COLOR_BLUE "MÁXIMO" COLOR_RESET " (sin pausas)\n");
+    } else if (modo.tipo == MODO_TASA) {
+        printf("Modo: " COLOR_BLUE "TASA" COLOR_RESET " (%.0f bytes/s)\n", modo.tasa);
+    } else if (modo.tipo == MODO_ADAPTATIVO) {
+        printf("Modo: " COLOR_BLUE "ADAPTATIVO" COLOR_RESET " (objetivo: %.0f%% del anillo ocupado)\n",
+               modo.objetivo * 100);
     } else {
-        printf("Modo: " COLOR_YELLOW "MANUAL" COLOR_RESET " (presionar tecla para leer)\n\n");
+        printf("Modo: " COLOR_YELLOW "MANUAL" COLOR_RESET " (presionar tecla para leer)\n");
         enable_raw_mode();
     }
+    printf("Lote: hasta %d caracteres por ciclo\n", modo.lote);
+    char bitacora_str[64];
+    bitacora_describir(modo.bitacora, modo.resumen_ms, bitacora_str, sizeof(bitacora_str));
+    char hilos_str[512];
+    hilos_describir(&hilos, hilos_str, sizeof(hilos_str));
+    printf("Espera: %s\n", nombre_espera(&modo.espera));
+    printf("Consola: %s\n", bitacora_str);
+    printf("Salida: %s\n", usar_escritor ? salida_str : "mmap");
+    printf("Hilos: %s\n\n", hilos_str);
 
     signal(SIGINT, signal_handler);
 
-    // Abrir memoria compartida (igual que antes)
-    int shm_fd = shm_open(shm_name, O_RDWR, 0666);
-    if (shm_fd == -1) {
-        perror("Error: No se puede abrir la memoria compartida");
-        fprintf(stderr, "¿Ejecutó el inicializador primero?\n");
+    // Conectarse al canal como receptor; drena su carril y roba de los demás cuando está vacío
+    canal_t *canal = canal_abrir(shm_name, CANAL_RECEPTOR, &modo.espera);
+    if (!canal) {
         return 1;
     }
-
-    size_t base_size = sizeof(shared_mem_t);
-    shared_mem_t *shm_temp = mmap(NULL, base_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-
-    if (shm_temp == MAP_FAILED) {
-        perror("Error al mapear memoria compartida (temporal)");
-        close(shm_fd);
-        return 1;
+    canal_info_t info;
+    canal_info(canal, &info);
+    modo.finalizar = canal_bandera_finalizar(canal);
+    if (modo.tipo == MODO_MANUAL) {
+        modo.cierre_fd = canal_aviso_cierre(canal);  // Antes de abrir los hilos de trabajo
     }
 
-    int buffer_size = shm_temp->buffer_size;
-    
-    if (buffer_size <= 0 || buffer_size > 10000) {
-        fprintf(stderr, "Error: buffer_size inválido (%d)\n", buffer_size);
-        munmap(shm_temp, base_size);
-        close(shm_fd);
-        return 1;
+    printf("Memoria compartida conectada (buffer: %d caracteres)\n", info.capacidad);
+    if (info.modo_anillo == CANAL_DIFUSION) {
+        printf("Difusión: leyendo todo desde el ticket %d\n", info.cursor);
+    } else {
+        printf("Carril propio: %d de %d\n", info.carril, info.carriles);
     }
 
-    munmap(shm_temp, base_size);
-
-    size_t shm_size = sizeof(shared_mem_t) + (buffer_size * sizeof(char_info_t));
-    shared_mem_t *shm = mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    
-    if (shm == MAP_FAILED) {
-        perror("Error al mapear memoria compartida (completa)");
-        close(shm_fd);
-        return 1;
-    }
+    /*
+     * La salida la preasigna el inicializador con el tamaño de la fuente.
+     * Cada receptor la mapea compartida y escribe cada byte en su offset,
+     * así que varios receptores reconstruyen el archivo en paralelo.
+     */
+    receptor_t receptor = { llave, NULL, info.tamano_fuente, info };
+    if (!usar_escritor) {
+        int output_fd = open(info.salida, O_RDWR);
+        if (output_fd == -1) {
+            perror("Error al abrir archivo de salida");
+            canal_cerrar(canal);
+            return 1;
+        }
 
-    printf("Memoria compartida conectada (buffer: %d caracteres)\n", buffer_size);
-
-    // Registrar este receptor
-    sem_wait(&shm->mutex);
-    shm->receptores_activos++;
-    sem_post(&shm->mutex);
-
-    FILE *output = fopen("output_receptor.txt", "w");
-    if (!output) {
-        perror("Error al crear archivo de salida");
-        sem_wait(&shm->mutex);
-        shm->receptores_activos--;
-        sem_post(&shm->mutex);
-        munmap(shm, shm_size);
-        close(shm_fd);
-        return 1;
+        if (receptor.output_size > 0) {
+            receptor.output = mmap(NULL, receptor.output_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                   output_fd, 0);
+            if (receptor.output == MAP_FAILED) {
+                perror("Error al mapear archivo de salida");
+                close(output_fd);
+                canal_cerrar(canal);
+                return 1;
+            }
+        }
+        close(output_fd);
     }
 
-    printf("\n" COLOR_CYAN "%-10s %-8s %-10s %-20s" COLOR_RESET "\n", 
-           "Carácter", "ASCII", "Posición", "Timestamp");
-    printf("--------------------------------------------------------\n");
-
-    int char_count = 0;
-
-    while (keep_running) {
-        // Verificar flag de finalización
-        sem_wait(&shm->mutex);
-        int debe_finalizar = shm->finalizar;
-        sem_post(&shm->mutex);
-        
-        if (debe_finalizar) {
-            printf("\n" COLOR_YELLOW "Receptor: Señal de finalización recibida\n" COLOR_RESET);
+    /*
+     * El hilo principal es el trabajador 0 y usa la conexión del proceso;
+     * los demás abren la suya sobre el mismo mapeo. Bitácora y escritor
+     * tienen colas de un solo productor: cada hilo tiene los suyos.
+     */
+    trabajador_t trabajadores[MAX_HILOS];
+    int n_trabajadores = 0;
+    int error = 0;
+    for (int i = 0; i < hilos.n; i++) {
+        trabajador_t *t = &trabajadores[i];
+        memset(t, 0, sizeof(*t));
+        t->receptor = &receptor;
+        t->hilos = &hilos;
+        t->indice = i;
+        t->modo = modo;
+        t->canal = i == 0 ? canal : canal_abrir_hilo(canal);
+        if (!t->canal) {
+            error = 1;
             break;
         }
-
-        // MODO DE EJECUCIÓN: Esperar según el modo
-        if (modo_automatico) {
-            wait_automatic(intervalo_ms);
-        } else {
-            if (!wait_for_keypress()) {
-                break;
+        if (usar_escritor) {
+            t->escritor = escritor_crear(info.salida, politica_flush, umbral_flush);
+            if (!t->escritor) {
+                perror("Error al iniciar el escritor de salida");
+                error = 1;
             }
         }
-
-        // Intentar leer (puede bloquearse si buffer está vacío)
-        if (sem_trywait(&shm->espacios_ocupados) == -1) {
-            if (errno == EAGAIN) {
-                printf(COLOR_RED "Buffer vacío, esperando datos...\n" COLOR_RESET);
-                sem_wait(&shm->espacios_ocupados);
-                
-                // Verificar de nuevo después de despertar
-                sem_wait(&shm->mutex);
-                debe_finalizar = shm->finalizar;
-                sem_post(&shm->mutex);
-                
-                if (debe_finalizar) {
-                    sem_post(&shm->espacios_ocupados);
-                    break;
-                }
-            } else {
-                if (errno != EINTR) {
-                    perror("Error en sem_trywait");
-                }
-                break;
+        // La consola la escribe un hilo aparte; el ciclo solo encola
+        if (!error) {
+            t->bitacora = bitacora_crear(BITACORA_RECEPTOR, modo.bitacora, modo.resumen_ms);
+            if (!t->bitacora) {
+                perror("Error al iniciar la bitácora");
+                error = 1;
+            }
+        }
+        if (error) {
+            if (t->escritor) {
+                escritor_cerrar(t->escritor);
+            }
+            if (i > 0) {
+                canal_cerrar(t->canal);
             }
+            break;
+        }
+        if (modo.bitacora == BITACORA_BYTES) {
+            canal_fijar_aviso(t->canal, COLOR_RED "Buffer vacío, esperando datos...\n" COLOR_RESET);
         }
+        n_trabajadores++;
+    }
 
-        sem_wait(&shm->mutex);
-        
-        int pos = shm->read_index % buffer_size;
-        unsigned char encrypted = shm->buffer[pos].valor;
-        int posicion_original = shm->buffer[pos].posicion;
-        time_t timestamp = shm->buffer[pos].timestamp;
-        
-        shm->read_index++;
-        
-        sem_post(&shm->mutex);
-        
-        unsigned char decrypted = encrypted ^ llave;
-        
-        sem_post(&shm->espacios_libres);
-        
-        // Escribir al archivo de salida
-        fputc(decrypted, output);
-        fflush(output);  // Asegurar que se escriba inmediatamente
-        
-        // Mostrar información del carácter leído
-        char display_char = (decrypted >= 32 && decrypted < 127) ? decrypted : '.';
-        struct tm *tm_info = localtime(&timestamp);
-        char time_str[20];
-        strftime(time_str, sizeof(time_str), "%H:%M:%S", tm_info);
-        
-        printf(COLOR_BLUE "'%c'" COLOR_RESET "        %-8d %-10d %s\n", 
-               display_char, decrypted, posicion_original, time_str);
-        
-        char_count++;
+    if (!error && modo.bitacora == BITACORA_BYTES) {
+        printf("\n" COLOR_CYAN "%-10s %-8s %-10s %-20s" COLOR_RESET "\n", 
+               "Carácter", "ASCII", "Posición", "Latencia(us)");
+        printf("--------------------------------------------------------\n");
     }
 
-    fclose(output);
+    int lanzados = 1;
+    if (!error) {
+        for (; lanzados < n_trabajadores; lanzados++) {
+            if (pthread_create(&trabajadores[lanzados].hilo, NULL, trabajar,
+                               &trabajadores[lanzados]) != 0) {
+                perror("Error al crear un hilo de trabajo");
+                break;
+            }
+        }
+        trabajar(&trabajadores[0]);
+    }
 
-    printf("\n" COLOR_YELLOW "Receptor finalizó: %d caracteres leídos" COLOR_RESET "\n", char_count);
-    printf("Texto guardado en: output_receptor.txt\n");
+    long long char_count = 0;
+    long long escrituras = 0;
+    for (int i = 0; i < n_trabajadores; i++) {
+        trabajador_t *t = &trabajadores[i];
+        if (i > 0 && i < lanzados) {
+            pthread_join(t->hilo, NULL);
+        }
+        bitacora_cerrar(t->bitacora);
+        if (t->escritor) {
+            // Vaciar lo pendiente antes de salir
+            escrituras += escritor_cerrar(t->escritor);
+        }
+        if (i > 0) {
+            canal_cerrar(t->canal);  // Antes que la conexión del proceso
+        }
+        char_count += t->char_count;
+    }
+    if (receptor.output) {
+        munmap(receptor.output, receptor.output_size);
+    }
+    if (usar_escritor) {
+        printf("Escrituras a disco: %lld\n", escrituras);
+    }
 
-    sem_wait(&shm->mutex);
-    shm->receptores_activos--;
-    sem_post(&shm->mutex);
+    printf("\n" COLOR_YELLOW "Receptor finalizó: %lld caracteres leídos" COLOR_RESET "\n", char_count);
+    printf("Texto guardado en: %s\n", info.salida);
 
-    munmap(shm, shm_size);
-    close(shm_fd);
+    canal_cerrar(canal);
 
-    return 0;
-}
\ No newline at end of file
+    return error;
+}
@@ -0,0 +1,205 @@
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "recuperacion.h"
+#include "registros.h"
+
+int proceso_vivo(int pid) {
+#ifdef SYS_pidfd_open
+    int fd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (fd >= 0) {
+        // El pidfd se vuelve legible cuando el proceso termina
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int terminado = poll(&pfd, 1, 0) > 0;
+        close(fd);
+        return !terminado;
+    }
+    if (errno == ESRCH) {
+        return 0;
+    }
+#endif
+    // Núcleos sin pidfd: kill(pid, 0) no distingue a los zombis
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Rellenar con huecos los tickets que el emisor reclamó y no publicó (modo lock-free)
+static int completar_escritura(shared_mem_t *shm, proceso_t *p) {
+    uint64_t ahora = reloj_ns();
+
+    for (int i = 0; i < p->vuelo_n; i++) {
+        int ticket = p->vuelo_primero + i;
+        int pos = carril_slot(shm, p->vuelo_carril, ticket);
+        int *secuencia = secuencia_slot(shm, pos);
+        int delta = __atomic_load_n(secuencia, __ATOMIC_ACQUIRE) - ticket;
+
+        if (delta < 0) {
+            return -1;  // La vuelta anterior del slot aún no se leyó
+        }
+        if (delta == 0) {
+            slot_escribir(shm, pos, 0, -1, ahora, 1);
+            publicar_secuencia(shm, secuencia, ticket + 1);
+            __atomic_fetch_add(&shm->slots_saltados, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return 0;
+}
+
+// Liberar los slots que el receptor reclamó y no alcanzó a liberar (modo lock-free)
+static int completar_lectura(shared_mem_t *shm, proceso_t *p) {
+    for (int i = 0; i < p->vuelo_n; i++) {
+        int ticket = p->vuelo_primero + i;
+        int *secuencia = secuencia_slot(shm, carril_slot(shm, p->vuelo_carril, ticket));
+        int delta = __atomic_load_n(secuencia, __ATOMIC_ACQUIRE) - ticket;
+
+        if (delta == 1) {
+            publicar_secuencia(shm, secuencia, ticket + shm->carril_size);
+            __atomic_fetch_add(&shm->slots_saltados, 1, __ATOMIC_RELAXED);
+        } else if (delta != shm->carril_size) {
+            return -1;  // El emisor del slot aún no lo publicó
+        }
+    }
+    return 0;
+}
+
+// Difusión: rellenar con huecos los tickets sin publicar, cuando ya no pisen a ningún receptor
+static int completar_difusion(shared_mem_t *shm, proceso_t *p) {
+    uint64_t ahora = reloj_ns();
+
+    for (int i = 0; i < p->vuelo_n; i++) {
+        int ticket = p->vuelo_primero + i;
+        int pos = carril_slot(shm, 0, ticket);
+        int *secuencia = secuencia_slot(shm, pos);
+
+        if (__atomic_load_n(secuencia, __ATOMIC_ACQUIRE) - (ticket + 1) >= 0) {
+            continue;  // Publicado (quizá ya en una vuelta posterior)
+        }
+        if (ticket - difusion_minimo(shm) >= shm->carril_size) {
+            return -1;  // El receptor más atrasado aún no leyó la vuelta anterior
+        }
+        slot_escribir(shm, pos, 0, -1, ahora, 1);
+        publicar_secuencia(shm, secuencia, ticket + 1);
+        __atomic_fetch_add(&shm->slots_saltados, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+// Registros: confirmar como hueco lo que reservó un emisor, o liberar lo que tomó un receptor
+static int completar_registro(shared_mem_t *shm, proceso_t *p) {
+    carril_t *c = &shm->carriles[0];
+
+    // Si murió con el mutex tomado, reparar_carril fija su fase al tomarlo
+    bloquear_carril(shm, 0);
+    pthread_mutex_unlock(&c->mutex);
+    if (p->fase != FASE_TICKETS && p->fase != FASE_PUBLICAR) {
+        return 0;
+    }
+
+    int ticket = p->vuelo_primero;
+    cabecera_registro_t *h = cabecera_registro(shm, ticket);
+    int estado = __atomic_load_n(&h->sello, __ATOMIC_ACQUIRE) - ticket;
+
+    if (p->tipo == PROCESO_EMISOR) {
+        if (estado == 0) {
+            h->posicion = -1;
+            h->marca_ns = reloj_ns();
+            publicar_secuencia(shm, &h->sello, ticket + 1);
+            __atomic_fetch_add(&shm->slots_saltados, 1, __ATOMIC_RELAXED);
+        }
+        return 0;
+    }
+
+    if (estado == 0) {
+        return -1;  // El emisor del registro aún no lo confirmó
+    }
+    if (estado == 1) {
+        __atomic_store_n(&h->sello, ticket + 2, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&shm->slots_saltados, 1, __ATOMIC_RELAXED);
+    }
+    bloquear_carril(shm, 0);
+    registros_recolectar(shm, c);
+    pthread_mutex_unlock(&c->mutex);
+    return 0;
+}
+
+// Completar la operación en curso de un proceso muerto; -1 si hay que reintentar
+static int reparar_proceso(shared_mem_t *shm, proceso_t *p) {
+    int emisor = p->tipo == PROCESO_EMISOR;
+
+    if (shm->modo_anillo == MODO_ANILLO_REGISTROS) {
+        return completar_registro(shm, p);
+    }
+
+    // En difusión un receptor no tiene nada en vuelo: basta con retirar su cursor
+    if (shm->modo_anillo == MODO_ANILLO_DIFUSION) {
+        if (!emisor) {
+            desuscribir(shm, p);
+        } else if (p->fase == FASE_TICKETS && completar_difusion(shm, p) < 0) {
+            return -1;
+        }
+        return 0;
+    }
+    carril_t *c = &shm->carriles[p->vuelo_carril];
+
+    // En modo mutex solo se está en FASE_TICKETS con el mutex del carril
+    // tomado: al tomarlo se recibe EOWNERDEAD y reparar_carril fija la fase
+    if (shm->modo_anillo == MODO_ANILLO_MUTEX && p->fase == FASE_TICKETS) {
+        bloquear_carril(shm, p->vuelo_carril);
+        pthread_mutex_unlock(&c->mutex);
+    }
+
+    switch (p->fase) {
+    case FASE_UNIDADES:
+        if (emisor) {
+            publicar_vuelo(&c->espacios_libres, p);
+        } else {
+            publicar_vuelo(&c->espacios_ocupados, p);
+            avisar_receptores(shm);
+        }
+        break;
+    case FASE_TICKETS:
+        if ((emisor ? completar_escritura(shm, p) : completar_lectura(shm, p)) < 0) {
+            return -1;
+        }
+        vuelo_publicar(p);
+        /* fall through */
+    case FASE_PUBLICAR:
+        if (emisor) {
+            publicar_datos(shm, p->vuelo_carril, p);
+        } else {
+            publicar_vuelo(&c->espacios_libres, p);
+        }
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+int recuperar_caidos(shared_mem_t *shm) {
+    int recuperados = 0;
+    int n = procesos_registrados(shm);
+
+    // Los registros de desborde son compartidos: no describen a un solo proceso
+    for (int i = 0; i < n && i < MAX_REGISTROS; i++) {
+        proceso_t *p = &shm->procesos[i];
+        if (__atomic_load_n(&p->activo, __ATOMIC_ACQUIRE) != PROCESO_ACTIVO || proceso_vivo(p->pid)) {
+            continue;
+        }
+        if (reparar_proceso(shm, p) < 0) {
+            continue;
+        }
+
+        __atomic_store_n(&p->esperando, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&p->activo, PROCESO_CAIDO, __ATOMIC_RELEASE);
+        ajustar_contador(shm, p->tipo == PROCESO_EMISOR ? &shm->emisores_activos
+                                                       : &shm->receptores_activos, -1);
+        __atomic_fetch_add(&shm->procesos_caidos, 1, __ATOMIC_RELAXED);
+        if (shm->modo_anillo == MODO_ANILLO_DIFUSION) {
+            avisar_emisores(shm);
+        }
+        recuperados++;
+    }
+    return recuperados;
+}
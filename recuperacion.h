@@ -0,0 +1,28 @@
+#ifndef RECUPERACION_H
+#define RECUPERACION_H
+
+#include "memoria_compartida.h"
+
+#define PERIODO_RECUPERACION_MS 50   // Cada cuánto el supervisor revisa los registros
+
+// 1 si el proceso sigue vivo; uno que ya terminó cuenta como muerto aunque siga zombi
+int proceso_vivo(int pid);
+
+/*
+ * Recuperar los procesos registrados como activos que murieron sin salir.
+ * La operación en curso de cada uno se completa según su fase: las
+ * unidades tomadas se devuelven, los tickets de un emisor que no llegó a
+ * escribir se rellenan con huecos (posicion = -1, los receptores los
+ * saltan), los slots que un receptor reclamó y no liberó se liberan, y las
+ * unidades que faltaban publicar se publican. En difusión el cursor de un
+ * receptor muerto deja de frenar a los emisores; en modo registros lo
+ * reservado se confirma como hueco y lo recibido se libera. Después se descuenta el
+ * proceso de emisores_activos o receptores_activos.
+ *
+ * Si un slot todavía depende de otro proceso (la vuelta anterior sin leer
+ * o un emisor sin publicar), el registro queda para la próxima pasada.
+ * Devuelve cuántos procesos quedaron recuperados en esta.
+ */
+int recuperar_caidos(shared_mem_t *shm);
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef REGISTROS_H
+#define REGISTROS_H
+
+#include "memoria_compartida.h"
+
+#define REGISTRO_MAX    4096     // Bytes de carga útil por registro
+#define REGISTROS_MIN_BUFFER 256 // Anillo mínimo en modo registros (bytes)
+
+#define REGISTRO_RELLENO -1      // len del relleno que cubre el final del anillo
+
+/*
+ * Cabecera de un registro en el anillo de bytes (modo registros). El sello
+ * dice en qué estado está el registro que empieza en el ticket t: t
+ * reservado, t + 1 confirmado y t + 2 liberado. Los tickets son offsets de
+ * bytes que solo crecen y son múltiplos de la alineación, así que un sello
+ * nunca se confunde con el de otra vuelta.
+ */
+typedef struct {
+    int sello;
+    int tam;                  // Bytes que ocupa en el anillo, cabecera incluida
+    int len;                  // Bytes de carga útil (REGISTRO_RELLENO = relleno)
+    int64_t posicion;         // Offset en el archivo fuente (-1 = hueco de un emisor caído)
+    uint64_t marca_ns;        // CLOCK_MONOTONIC al confirmar
+} cabecera_registro_t;
+
+#define REGISTRO_ALINEACION ((int)sizeof(cabecera_registro_t))
+
+// Vista de un registro reservado (emisor) o recibido (receptor), ver canal.h
+typedef canal_registro_t registro_t;
+
+static inline cabecera_registro_t *cabecera_registro(shared_mem_t *shm, int ticket) {
+    return (cabecera_registro_t *)(void *)((char *)shm->buffer + (ticket & shm->carril_mask));
+}
+
+// Carga útil máxima de un registro: a lo sumo medio anillo, para que siempre quepa tras un relleno
+static inline int registro_max(const shared_mem_t *shm) {
+    int max = shm->buffer_size / 2 - REGISTRO_ALINEACION;
+    return max < REGISTRO_MAX ? max : REGISTRO_MAX;
+}
+
+static inline int registro_tam(int len) {
+    return (REGISTRO_ALINEACION + len + REGISTRO_ALINEACION - 1) / REGISTRO_ALINEACION *
+           REGISTRO_ALINEACION;
+}
+
+/*
+ * Dormir en un índice del carril hasta que cambie de valor visto, girando
+ * antes según la política. Devuelve -1 si se activó finalizar.
+ */
+static inline int registros_esperar(shared_mem_t *shm, int *indice, int visto,
+                                    const espera_t *espera, unsigned int *spins) {
+    if (__atomic_load_n(&shm->finalizar, __ATOMIC_RELAXED)) {
+        return -1;
+    }
+    if (seguir_girando(espera, *spins)) {
+        cpu_relax(spins);
+        return 0;
+    }
+    __atomic_fetch_add(&shm->esperando_slot, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(indice, __ATOMIC_SEQ_CST) == visto &&
+        !__atomic_load_n(&shm->finalizar, __ATOMIC_SEQ_CST)) {
+        futex_esperar(indice, visto);
+    }
+    __atomic_fetch_sub(&shm->esperando_slot, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static inline void registros_avisar(shared_mem_t *shm, int *indice) {
+    if (__atomic_load_n(&shm->esperando_slot, __ATOMIC_SEQ_CST) > 0) {
+        futex_despertar(indice);
+    }
+}
+
+/*
+ * Avanzar liberado sobre los registros ya liberados y contiguos (con el
+ * mutex del carril tomado). Los receptores liberan en cualquier orden; el
+ * espacio vuelve a los emisores cuando se libera el más antiguo.
+ */
+static inline void registros_recolectar(shared_mem_t *shm, carril_t *c) {
+    int liberado = c->liberado;
+    while (liberado != c->read_index) {
+        cabecera_registro_t *h = cabecera_registro(shm, liberado);
+        if (__atomic_load_n(&h->sello, __ATOMIC_ACQUIRE) != liberado + 2) {
+            break;
+        }
+        liberado += h->tam;
+    }
+    if (liberado != c->liberado) {
+        __atomic_store_n(&c->liberado, liberado, __ATOMIC_SEQ_CST);
+        registros_avisar(shm, &c->liberado);
+    }
+}
+
+/*
+ * Reservar len bytes contiguos en el anillo y devolver un puntero para
+ * escribirlos en el lugar; si no caben antes del final se deja un relleno
+ * y el registro empieza al principio. Solo se toma el mutex para mover
+ * write_index: la carga útil se escribe fuera y se publica con
+ * registro_confirmar(). Devuelve NULL si se activó finalizar.
+ */
+static inline char *registro_reservar(shared_mem_t *shm, int len, const espera_t *espera,
+                                      proceso_t *dueno, registro_t *r) {
+    carril_t *c = &shm->carriles[0];
+    int tam = registro_tam(len);
+    unsigned int spins = 0;
+
+    for (;;) {
+        bloquear_carril(shm, 0);
+        int ticket = c->write_index;
+        int hasta_final = shm->buffer_size - (ticket & shm->carril_mask);
+        int relleno = hasta_final < tam ? hasta_final : 0;
+        int liberado = c->liberado;
+
+        if (ticket + relleno + tam - liberado <= shm->buffer_size) {
+            if (relleno > 0) {
+                cabecera_registro_t *p = cabecera_registro(shm, ticket);
+                p->tam = relleno;
+                p->len = REGISTRO_RELLENO;
+                __atomic_store_n(&p->sello, ticket + 2, __ATOMIC_RELEASE);
+                ticket += relleno;
+            }
+            cabecera_registro_t *h = cabecera_registro(shm, ticket);
+            h->tam = tam;
+            h->len = len;
+            __atomic_store_n(&h->sello, ticket, __ATOMIC_RELEASE);
+
+            vuelo_unidades(dueno, 0, 1);
+            vuelo_tickets(dueno, ticket);
+            __atomic_store_n(&c->write_index, ticket + tam, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&c->mutex);
+            registros_avisar(shm, &c->write_index);
+
+            r->ticket = ticket;
+            r->len = len;
+            r->datos = (char *)(h + 1);
+            return r->datos;
+        }
+        pthread_mutex_unlock(&c->mutex);
+
+        // Anillo lleno: esperar a que los receptores liberen el registro más antiguo
+        if (registros_esperar(shm, &c->liberado, liberado, espera, &spins) < 0) {
+            return NULL;
+        }
+    }
+}
+
+// Publicar un registro reservado: desde aquí un receptor puede leerlo
+static inline void registro_confirmar(shared_mem_t *shm, registro_t *r, int64_t posicion,
+                                      proceso_t *dueno) {
+    cabecera_registro_t *h = cabecera_registro(shm, r->ticket);
+    h->posicion = posicion;
+    h->marca_ns = reloj_ns();
+    vuelo_publicar(dueno);
+    publicar_secuencia(shm, &h->sello, r->ticket + 1);
+    __atomic_store_n(&dueno->fase, FASE_LIBRE, __ATOMIC_RELEASE);
+}
+
+/*
+ * Tomar el registro más antiguo sin leer y devolver una vista de su carga
+ * útil en la memoria compartida, válida hasta registro_liberar(). Se salta
+ * el relleno y se espera a que el emisor lo confirme. Devuelve NULL si se
+ * activó finalizar; *durmio queda en 1 si el anillo estaba vacío.
+ */
+static inline const char *registro_recibir(shared_mem_t *shm, const espera_t *espera,
+                                           proceso_t *dueno, registro_t *r, int *durmio) {
+    carril_t *c = &shm->carriles[0];
+    unsigned int spins = 0;
+    cabecera_registro_t *h;
+
+    *durmio = 0;
+    for (;;) {
+        bloquear_carril(shm, 0);
+        int ticket = c->read_index;
+        int escrito = c->write_index;
+        h = cabecera_registro(shm, ticket);
+        if (ticket != escrito && h->len == REGISTRO_RELLENO) {
+            __atomic_store_n(&c->read_index, ticket + h->tam, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
+        if (ticket != escrito) {
+            vuelo_unidades(dueno, 0, 1);
+            vuelo_tickets(dueno, ticket);
+            __atomic_store_n(&c->read_index, ticket + h->tam, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(&c->mutex);
+            r->ticket = ticket;
+            break;
+        }
+        pthread_mutex_unlock(&c->mutex);
+
+        *durmio = 1;
+        if (registros_esperar(shm, &c->write_index, escrito, espera, &spins) < 0) {
+            return NULL;
+        }
+    }
+
+    if (esperar_secuencia(shm, &h->sello, r->ticket + 1, espera, dueno) < 0) {
+        return NULL;  // El registro queda en vuelo: lo libera el supervisor si hace falta
+    }
+    r->len = h->len;
+    r->posicion = h->posicion;
+    r->marca_ns = h->marca_ns;
+    r->datos = (char *)(h + 1);
+    return r->datos;
+}
+
+// Devolver el espacio de un registro recibido; la vista deja de ser válida
+static inline void registro_liberar(shared_mem_t *shm, registro_t *r, proceso_t *dueno) {
+    carril_t *c = &shm->carriles[0];
+    vuelo_publicar(dueno);
+    __atomic_store_n(&cabecera_registro(shm, r->ticket)->sello, r->ticket + 2, __ATOMIC_RELEASE);
+    bloquear_carril(shm, 0);
+    registros_recolectar(shm, c);
+    pthread_mutex_unlock(&c->mutex);
+    __atomic_store_n(&dueno->fase, FASE_LIBRE, __ATOMIC_RELEASE);
+}
+
+#endif